@@ -0,0 +1,151 @@
+//  A. L. Delcher
+//
+//  File:  aho-corasick.cc
+//
+//  Last Modified:  19 Oct 2026
+//
+//  An Aho-Corasick automaton to find all exact occurrences of a set
+//  of patterns in a string in one pass
+
+
+#include  "aho-corasick.hh"
+
+
+
+Aho_Corasick_t :: Aho_Corasick_t
+    ()
+
+  {
+   memset (char_class, 0, sizeof (char_class));
+   num_classes = 1;
+   built = false;
+  }
+
+
+
+void  Aho_Corasick_t :: Add
+    (const char * p)
+
+//  Add  p  to the patterns to search for.  Its subscript in matches
+//  is the number of patterns added before it.  An empty pattern never
+//  matches.  Patterns can't be added after  Build .
+
+  {
+   assert (! built);
+   pattern . push_back (p);
+
+   return;
+  }
+
+
+
+void  Aho_Corasick_t :: Build
+    (void)
+
+//  Make the automaton for the patterns added.  The trie is built
+//  first, then the failure links are found breadth first, filling
+//  in each missing transition from the failure state's row, which
+//  is already complete since it's shallower.
+
+  {
+   vector <int>  fail, queue;
+   int  c, i, j, k, n, s, t, w;
+
+   for  (i = 0;  i < Num_Patterns ();  i ++)
+     for  (j = 0;  pattern [i] [j] != '\0';  j ++)
+       {
+        unsigned char  ch = pattern [i] [j];
+
+        if  (char_class [ch] == 0)
+            char_class [ch] = num_classes ++;
+       }
+   w = num_classes;
+
+   next . assign (w, -1);
+   out . assign (1, -1);
+   same_end . assign (Num_Patterns (), -1);
+   for  (i = 0;  i < Num_Patterns ();  i ++)
+     {
+      n = pattern [i] . length ();
+      if  (n == 0)
+          continue;
+      for  (s = j = 0;  j < n;  j ++)
+        {
+         c = char_class [(unsigned char) pattern [i] [j]];
+         if  (next [s * w + c] < 0)
+             {
+              next [s * w + c] = out . size ();
+              next . resize (next . size () + w, -1);
+              out . push_back (-1);
+             }
+         s = next [s * w + c];
+        }
+      same_end [i] = out [s];
+      out [s] = i;
+     }
+
+   n = out . size ();
+   fail . assign (n, 0);
+   out_link . assign (n, 0);
+   for  (c = 0;  c < w;  c ++)
+     if  (next [c] < 0)
+         next [c] = 0;
+       else
+         queue . push_back (next [c]);
+
+   for  (k = 0;  k < int (queue . size ());  k ++)
+     {
+      s = queue [k];
+      for  (c = 0;  c < w;  c ++)
+        {
+         t = next [s * w + c];
+         if  (t < 0)
+             next [s * w + c] = next [fail [s] * w + c];
+           else
+             {
+              fail [t] = next [fail [s] * w + c];
+              out_link [t] = (0 <= out [fail [t]] ? fail [t] : out_link [fail [t]]);
+              queue . push_back (t);
+             }
+        }
+     }
+
+   built = true;
+
+   return;
+  }
+
+
+
+void  Aho_Corasick_t :: Scan
+    (const char * s, size_t n, vector <Pattern_Match_t> & match)  const
+
+//  Set  match  to all occurrences in the  n  characters of  s  of
+//  the patterns, in order of their end positions.  Patterns that end
+//  at the same position are in no particular order.
+
+  {
+   Pattern_Match_t  m;
+   size_t  i;
+   int  k, state, t;
+
+   assert (built);
+   match . clear ();
+
+   state = 0;
+   for  (i = 0;  i < n;  i ++)
+     {
+      state = next [state * num_classes + char_class [(unsigned char) s [i]]];
+      for  (t = (0 <= out [state] ? state : out_link [state]);  t != 0;
+              t = out_link [t])
+        for  (k = out [t];  k >= 0;  k = same_end [k])
+          {
+           m . end = i;
+           m . pattern = k;
+           m . mismatches = 0;
+           match . push_back (m);
+          }
+     }
+
+   return;
+  }
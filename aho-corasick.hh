@@ -0,0 +1,73 @@
+//  A. L. Delcher
+//
+//  File:  aho-corasick.hh
+//
+//  Last Modified:  19 Oct 2026
+//
+//  An Aho-Corasick automaton to find all exact occurrences of a set
+//  of patterns in a string in one pass
+
+
+#ifndef  __AHO_CORASICK_H_INCLUDED
+#define  __AHO_CORASICK_H_INCLUDED
+
+
+#include  "delcher.hh"
+#include  <string>
+#include  <vector>
+
+
+struct  Pattern_Match_t
+  {
+   // An occurrence of a pattern found by  Aho_Corasick_t  or  Shift_And_t
+   long int  end;
+     // position in the string of the last character of the match
+   int  pattern;
+     // subscript of the pattern matched, in the order they were added
+   int  mismatches;
+     // number of characters that differ from the pattern
+  };
+
+
+class  Aho_Corasick_t
+  {
+   // The patterns are stored in a trie with a failure link from each
+   // node to the node of its longest proper suffix that's also in the
+   // trie, and these are compiled into a full transition table, so
+   // scanning takes one table lookup per character plus one step for
+   // each match.  Characters are mapped to classes first:  one for
+   // each character that's in some pattern and one for all the others,
+   // so the table has only a few columns for DNA patterns.  Matching
+   // is exact and case-sensitive.
+   private:
+     vector <string>  pattern;
+     unsigned char  char_class [256];
+     int  num_classes;
+     vector <int>  next;
+       // next [s * num_classes + c]  is the state after state  s  on
+       // class  c ; state 0 is the root
+     vector <int>  out;
+       // subscript of a pattern ending at each state, or -1
+     vector <int>  out_link;
+       // nearest state on the failure chain of each state that has an
+       // output, or 0 if there's none
+     vector <int>  same_end;
+       // next pattern with the same end state as each pattern, or -1
+     bool  built;
+
+   public:
+     Aho_Corasick_t
+         ();
+     void  Add
+         (const char * p);
+     void  Build
+         (void);
+     int  Num_Patterns
+         (void)  const
+       { return  int (pattern . size ()); }
+     void  Scan
+         (const char * s, size_t n, vector <Pattern_Match_t> & match)  const;
+  };
+
+
+#endif
@@ -0,0 +1,48 @@
+//  A. L. Delcher
+//
+//  File:  codon.cc
+//
+//  Last Modified:  19 Oct 2026
+//
+//  Functions to find stop codons and open reading frames
+
+
+#include  "codon.hh"
+
+
+void  Scan_Open_Frames
+  (const char * s, int n, int frame, unsigned char & fwd_open,
+   unsigned char & rev_open)
+
+// Clear the bits of open-frame masks fwd_open and rev_open for the
+// frames of s [0 .. (n - 1)] that contain a stop codon on the forward
+// and reverse strand, respectively.  frame is the frame of the codon
+// starting at s [0]; the codon starting at s [i] is in frame
+// (frame + i) % 3 on both strands.  Each codon's code is updated from
+// the previous one by shifting in one base.  A codon with a
+// character other than ACGT is never a stop.
+
+{
+  unsigned  code, bad, b;
+  int  f, i;
+
+  code = bad = 0;
+  f = (frame + 2) % 3;  // frame before the first codon
+  for (i = 0; i < n; i ++)
+    {
+      b = BASE_CODE [(unsigned char) s [i]];
+      code = ((code << 2) | (b & 0x3)) & 0x3F;
+      bad = ((bad << 1) | (b >> 2)) & 0x7;
+      if (i < 2)
+        continue;
+
+      f = (f + 1) % 3;
+      if (bad == 0)
+        {
+          fwd_open = Close_Frame (fwd_open, f, code);
+          rev_open = Close_Rev_Frame (rev_open, f, code);
+        }
+    }
+
+  return;
+}
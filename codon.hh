@@ -0,0 +1,105 @@
+//  A. L. Delcher
+//
+//  File:  codon.hh
+//
+//  Last Modified:  19 Oct 2026
+//
+//  Tables to find stop codons and track open reading frames using
+//  2-bit codon codes
+
+
+#ifndef  __CODON_HH_INCLUDED
+#define  __CODON_HH_INCLUDED
+
+#include  "delcher.hh"
+
+
+const unsigned  NO_CODON = 64;
+  // Code of a codon with a character other than ACGT
+
+static const unsigned char  BASE_CODE [256]
+  = {4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+     4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4};
+  // 2-bit code of each base (A=0, C=1, G=2, T=3, either case);
+  // 4 for any other character
+static const unsigned char  NUM_OPEN_FRAMES [8]
+  = {0, 1, 1, 2, 1, 2, 2, 3};
+  // Number of frames open in each 3-bit open-frame mask
+static const unsigned char  STOP_CODON [NO_CODON + 1]
+  = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0,
+     0};
+  // 1 for the codes of TAA (48), TAG (50) and TGA (56), else 0
+static const unsigned char  RC_STOP_CODON [NO_CODON + 1]
+  = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+     0};
+  // 1 for the codes of CTA (28), TCA (52) and TTA (60), whose reverse
+  // complements are stop codons, else 0
+
+
+inline unsigned  Codon_Code
+  (const char * s)
+
+// Return the 6-bit code of the codon in the first 3 characters of s,
+// or NO_CODON if any of them isn't ACGT
+
+{
+  unsigned  a, b, c;
+
+  a = BASE_CODE [(unsigned char) s [0]];
+  b = BASE_CODE [(unsigned char) s [1]];
+  c = BASE_CODE [(unsigned char) s [2]];
+  if ((a | b | c) & 0x4)
+    return  NO_CODON;
+
+  return  (a << 4) | (b << 2) | c;
+}
+
+
+inline unsigned char  Close_Frame
+  (unsigned char open_frame, int frame, unsigned code)
+
+// Return open-frame mask open_frame after reading the codon with
+// code in frame.  The frame's bit is cleared if it's a stop codon.
+
+{
+  return  open_frame & ~(STOP_CODON [code] << frame);
+}
+
+
+inline unsigned char  Close_Rev_Frame
+  (unsigned char open_frame, int frame, unsigned code)
+
+// Same as Close_Frame, but for a codon whose reverse complement is
+// read on the other strand
+
+{
+  return  open_frame & ~(RC_STOP_CODON [code] << frame);
+}
+
+
+void  Scan_Open_Frames
+  (const char * s, int n, int frame, unsigned char & fwd_open,
+   unsigned char & rev_open);
+
+
+#endif
@@ -422,3 +422,19 @@ char *  Strip_Trailing
 
 
 
+
+
+
+double  Wall_Time
+  (void)
+
+//  Return the current wall-clock time in seconds from an arbitrary
+//  fixed starting point.  Only differences between values are meaningful.
+
+  {
+   struct timespec  ts;
+
+   clock_gettime (CLOCK_MONOTONIC, & ts);
+
+   return  ts . tv_sec + 1e-9 * ts . tv_nsec;
+  }
@@ -109,6 +109,8 @@ void *  Safe_realloc
    size_t line_num = 0);
 char *  Strip_Trailing
   (char * s, char ch);
+double  Wall_Time
+  (void);
 
 
 template <class DT>  void  Incr_Limited
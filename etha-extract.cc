@@ -0,0 +1,197 @@
+//  A. L. Delcher
+//
+//  File:  etha-extract.cc
+//
+//  Last Modified:  19 Oct 2026
+//
+//  This program extracts regions of the sequences in a fasta file
+//  given by a list of coordinates in the format used by glimmer's
+//  multi-extract.  Each line of the list is:
+//    tag  seq-id  start  end
+//  where start and end are the positions (counting from 1) of the
+//  first and last bases of the region.  If start > end the region is
+//  the reverse complement of end .. start .  Output is the regions in
+//  multi-fasta format with the tags as headers.  The sequence file is
+//  accessed through a  .fai  index, which is built if necessary, so
+//  each region is read directly without scanning the file.  It can
+//  also be a packed genome file made by  etha-pack .
+
+
+#include  "etha-extract.hh"
+
+
+// External variables
+
+extern int  Verbose;
+extern int  Global_Debug_Flag;
+
+
+// Global variables
+
+static char  * Coord_Filename = NULL;
+  // Name of file with the list of regions to extract
+static char  * Sequence_Filename = NULL;
+  // Name of the fasta or packed genome file to extract regions from
+
+
+int  main
+  (int argc, char * argv [])
+
+{
+  FILE  * coord_fp;
+  Fasta_Index_t  seq_index;
+  Packed_Genome_t  genome;
+  string  seq;
+  char  line [MAX_LINE], tag [MAX_LINE], id [MAX_LINE];
+  long int  start, end, lo, hi;
+  char  strand;
+  bool  found, packed;
+  int  line_num = 0;
+
+  Verbose = 0;
+
+  Parse_Command_Line (argc, argv);
+
+  Fasta_Buffer_Output (stdout);
+
+  packed = Packed_Genome_t :: Is_Packed (Sequence_Filename);
+  if (packed)
+    genome . Open (Sequence_Filename);
+  else
+    seq_index . Open (Sequence_Filename);
+
+  if (strcmp (Coord_Filename, "-") == 0)
+    coord_fp = stdin;
+  else
+    coord_fp = File_Open (Coord_Filename, "r");
+
+  while  (fgets (line, MAX_LINE, coord_fp) != NULL)
+    {
+      line_num ++;
+      if (First_Non_Blank (line) == ' ' || First_Non_Blank (line) == '#')
+        continue;
+      if (sscanf (line, "%s %s %ld %ld", tag, id, & start, & end) != 4)
+        {
+          fprintf (stderr, "ERROR:  Bad coordinate line %d:  %s", line_num,
+                   line);
+          continue;
+        }
+
+      if (start <= end)
+        {
+          lo = start - 1;
+          hi = end;
+          strand = '+';
+        }
+      else
+        {
+          lo = end - 1;
+          hi = start;
+          strand = '-';
+        }
+
+      if (packed)
+        found = genome . Extract (seq, id, lo, hi, strand);
+      else
+        found = seq_index . Extract (seq, id, lo, hi, strand);
+      if (! found)
+        {
+          fprintf (stderr, "ERROR:  Sequence %s not found for %s\n", id, tag);
+          continue;
+        }
+      if (0 < Verbose && long (seq . length ()) < hi - lo)
+        fprintf (stderr, "Region %s clipped to %ld bases\n", tag,
+                 long (seq . length ()));
+
+      Fasta_Print (stdout, seq . c_str (), tag);
+    }
+
+  if (coord_fp != stdin)
+    fclose (coord_fp);
+
+  return  0;
+}
+
+
+static void  Parse_Command_Line
+  (int argc, char * argv [])
+
+//  Get options and parameters from command line with  argc
+//  arguments in  argv [0 .. (argc - 1)] .
+
+{
+  bool  errflg = false;
+  int  ch;
+
+  optarg = NULL;
+
+  while  (! errflg
+          && ((ch = getopt (argc, argv, "hV:w")) != EOF))
+
+    switch  (ch)
+      {
+      case  'h' :
+        Usage ();
+        exit (EXIT_SUCCESS);
+
+      case  'V' :
+        Verbose = strtol (optarg, NULL, 10);
+        break;
+
+      case  'w' :
+        // accepted for command lines written for multi-extract;
+        // start > end always means the reverse strand
+        break;
+
+      default :
+        errflg = true;
+      }
+
+  if  (errflg || optind > argc - 2)
+    {
+      Usage ();
+      exit (EXIT_FAILURE);
+    }
+
+  Sequence_Filename = argv [optind ++];
+  Coord_Filename = argv [optind ++];
+
+  return;
+}
+
+
+static void  Usage
+  (void)
+
+//  Print to stderr description of options and command line for
+//  this program.
+
+{
+  fprintf (stderr,
+    "USAGE:  etha-extract [options] <sequence-file> <coord-file>\n"
+    "\n"
+    "Extract regions of the sequences in multi-fasta file <sequence-file>\n"
+    "listed in <coord-file>, which can be '-' for stdin.  Each line of\n"
+    "<coord-file> is:\n"
+    "  tag  seq-id  start  end\n"
+    "where start and end are the positions (counting from 1) of the\n"
+    "first and last bases of the region in the sequence whose header\n"
+    "starts with seq-id.  If start > end the region is reverse\n"
+    "complemented.  Regions are clipped to the sequence.  Output is the\n"
+    "regions in multi-fasta format to stdout with the tags as headers.\n"
+    "The sequence file is indexed in <sequence-file>.fai, which is\n"
+    "reused if it's up to date.  All lines of a sequence but its last\n"
+    "must be the same length.  <sequence-file> can also be a packed\n"
+    "genome file made by etha-pack.\n"
+    "\n"
+    "Options:\n"
+    " -h\n"
+    "    Print this message\n"
+    " -V <n>\n"
+    "    Set verbose level to <n>.  Higher values are more debugging output.\n"
+    " -w\n"
+    "    Ignored; accepted for compatibility with multi-extract command lines\n"
+    "\n");
+
+  return;
+}
@@ -0,0 +1,30 @@
+//  A. L. Delcher
+//
+//  File:  etha-extract.hh
+//
+//  Last Modified:  19 Oct 2026
+//
+//  Declarations for  etha-extract.cc
+
+
+
+#ifndef  __ETHA_EXTRACT_HH_INCLUDED
+#define  __ETHA_EXTRACT_HH_INCLUDED
+
+
+#include  "delcher.hh"
+#include  "fasta.hh"
+#include  "fasta-index.hh"
+#include  "packed-genome.hh"
+
+
+const int  MAX_LINE = 1000;
+  // Length of longest input line
+
+
+static void  Parse_Command_Line
+  (int argc, char * argv []);
+static void  Usage
+  (void);
+
+#endif
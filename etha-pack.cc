@@ -0,0 +1,129 @@
+//  A. L. Delcher
+//
+//  File:  etha-pack.cc
+//
+//  Last Modified:  19 Oct 2026
+//
+//  This program converts a multi-fasta file to a packed genome file,
+//  which stores the sequences with 2 bits per base and a list of the
+//  runs of N's in each.  Programs such as  etha-extract  map the packed
+//  file into memory and read regions of it directly, without parsing
+//  the text again, in about a quarter of the space.
+
+
+#include  "etha-pack.hh"
+
+
+// External variables
+
+extern int  Verbose;
+extern int  Global_Debug_Flag;
+
+
+// Global variables
+
+static char  * Packed_Filename = NULL;
+  // Name of the packed genome file to write
+static char  * Sequence_Filename = NULL;
+  // Name of the fasta file to convert
+
+
+int  main
+  (int argc, char * argv [])
+
+{
+  FILE  * fp;
+  long int  n;
+
+  Verbose = 0;
+
+  Parse_Command_Line (argc, argv);
+
+  if (strcmp (Sequence_Filename, "-") == 0)
+    fp = stdin;
+  else
+    fp = File_Open (Sequence_Filename, "r");
+
+  Seq_Reader_t  seq_reader (fp);
+
+  n = Packed_Genome_t :: Write (seq_reader, Packed_Filename);
+
+  if (0 < Verbose)
+    fprintf (stderr, "Packed %s sequences into %s\n", Commatize (n),
+             Packed_Filename);
+
+  if (fp != stdin)
+    fclose (fp);
+
+  return  0;
+}
+
+
+static void  Parse_Command_Line
+  (int argc, char * argv [])
+
+//  Get options and parameters from command line with  argc
+//  arguments in  argv [0 .. (argc - 1)] .
+
+{
+  bool  errflg = false;
+  int  ch;
+
+  optarg = NULL;
+
+  while  (! errflg
+          && ((ch = getopt (argc, argv, "hV:")) != EOF))
+
+    switch  (ch)
+      {
+      case  'h' :
+        Usage ();
+        exit (EXIT_SUCCESS);
+
+      case  'V' :
+        Verbose = strtol (optarg, NULL, 10);
+        break;
+
+      default :
+        errflg = true;
+      }
+
+  if  (errflg || optind > argc - 2)
+    {
+      Usage ();
+      exit (EXIT_FAILURE);
+    }
+
+  Sequence_Filename = argv [optind ++];
+  Packed_Filename = argv [optind ++];
+
+  return;
+}
+
+
+static void  Usage
+  (void)
+
+//  Print to stderr description of options and command line for
+//  this program.
+
+{
+  fprintf (stderr,
+    "USAGE:  etha-pack [options] <sequence-file> <packed-file>\n"
+    "\n"
+    "Read multi-fasta or fastq sequences, which may be gzip-compressed,\n"
+    "from <sequence-file>, which can be '-' for stdin, and write them to\n"
+    "<packed-file> with 2 bits per base.  Characters other than A, C, G\n"
+    "and T are stored as N's and case is not kept.  Sequences are named\n"
+    "by the first word of their headers.  etha-extract reads regions\n"
+    "from <packed-file> as it does from a fasta file.\n"
+    "\n"
+    "Options:\n"
+    " -h\n"
+    "    Print this message\n"
+    " -V <n>\n"
+    "    Set verbose level to <n>.  Higher values are more debugging output.\n"
+    "\n");
+
+  return;
+}
@@ -0,0 +1,25 @@
+//  A. L. Delcher
+//
+//  File:  etha-pack.hh
+//
+//  Last Modified:  19 Oct 2026
+//
+//  Declarations for  etha-pack.cc
+
+
+
+#ifndef  __ETHA_PACK_HH_INCLUDED
+#define  __ETHA_PACK_HH_INCLUDED
+
+
+#include  "delcher.hh"
+#include  "fasta.hh"
+#include  "packed-genome.hh"
+
+
+static void  Parse_Command_Line
+  (int argc, char * argv []);
+static void  Usage
+  (void);
+
+#endif
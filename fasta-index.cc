@@ -0,0 +1,339 @@
+//  A. L. Delcher
+//
+//  File:  fasta-index.cc
+//
+//  Last Modified:  19 Oct 2026
+//
+//  Random access to regions of the sequences in a fasta file
+//  using a samtools-style  .fai  index
+
+
+#include  "fasta-index.hh"
+
+#include  <fcntl.h>
+#include  <sys/mman.h>
+#include  <sys/stat.h>
+#include  <unistd.h>
+
+
+static const char  COMPLEMENT_TABLE []
+  = "nnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnn"
+    " nnnnnnnnn*nn-.nnnnnnnnnnnnnnnnn"
+    "nTVGHNNCDNNMNKNNNNYSANBWNRNnnnn_"
+    "ntvghnncdnnmnknnnnysanbwnrnnnnnn";
+
+
+
+Fasta_Index_t :: Fasta_Index_t
+    ()
+
+  {
+   data = NULL;
+   data_len = 0;
+  }
+
+
+
+Fasta_Index_t :: ~ Fasta_Index_t
+    ()
+
+  {
+   if  (data != NULL)
+       munmap ((void *) data, data_len);
+  }
+
+
+
+void  Fasta_Index_t :: Add_Entry
+    (const Fasta_Index_Entry_t & e)
+
+//  Add  e  to the end of the index.  If its id is already used
+//  print a warning; lookups by that id find the first one.
+
+  {
+   if  (lookup . find (e . id) != lookup . end ())
+       fprintf (stderr, "WARNING:  Duplicate sequence id %s in %s\n",
+            e . id . c_str (), filename . c_str ());
+     else
+       lookup [e . id] = int (entry . size ());
+
+   entry . push_back (e);
+
+   return;
+  }
+
+
+
+void  Fasta_Index_t :: Build
+    (void)
+
+//  Make the index by scanning the mapped file.  Exit with a message
+//  if a sequence has lines of different lengths other than its last
+//  one, since then positions in it can't be computed.
+
+  {
+   const char  * end = data + data_len;
+   const char  * p, * eol;
+   Fasta_Index_Entry_t  e;
+   long int  bases, bytes;
+   bool  short_line;
+
+   p = data;
+   while  (p < end && * p != '>')
+     {
+      // skip anything before the first header
+      eol = (const char *) memchr (p, '\n', end - p);
+      p = (eol == NULL ? end : eol + 1);
+     }
+
+   while  (p < end)
+     {
+      // header line:  the id is its first word
+      for  (p ++;  p < end && * p == ' ';  p ++)
+        ;
+      for  (eol = p;  eol < end && ! isspace ((unsigned char) * eol);  eol ++)
+        ;
+      e . id . assign (p, eol - p);
+      eol = (const char *) memchr (eol, '\n', end - eol);
+      p = (eol == NULL ? end : eol + 1);
+
+      e . offset = p - data;
+      e . len = e . line_bases = e . line_bytes = 0;
+      short_line = false;
+      while  (p < end && * p != '>')
+        {
+         eol = (const char *) memchr (p, '\n', end - p);
+         bytes = (eol == NULL ? end - p : eol + 1 - p);
+         bases = (eol == NULL ? end - p : eol - p);
+         if  (0 < bases && p [bases - 1] == '\r')
+             bases --;
+
+         if  (0 < bases)
+             {
+              if  (short_line
+                     || (0 < e . line_bases
+                           && (e . line_bases < bases
+                                 || (bases == e . line_bases
+                                       && bytes != e . line_bytes))))
+                  {
+                   sprintf (Clean_Exit_Msg_Line,
+                        "ERROR:  Can't index %s:  sequence %s has lines of"
+                        " different lengths", filename . c_str (),
+                        e . id . c_str ());
+                   Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+                  }
+              if  (e . line_bases == 0)
+                  {
+                   e . line_bases = bases;
+                   e . line_bytes = bytes;
+                  }
+              e . len += bases;
+             }
+         if  (bases < e . line_bases || bases == 0)
+             short_line = true;
+         p += bytes;
+        }
+
+      Add_Entry (e);
+     }
+
+   return;
+  }
+
+
+
+bool  Fasta_Index_t :: Extract
+    (string & s, const char * id, long int lo, long int hi, char strand)
+
+//  Set  s  to the region  lo .. hi  of the sequence named  id , in
+//  0-based between coordinates, e.g., the first 3 bases are lo=0, hi=3.
+//  The region is clipped to the sequence.  If  strand  is '-' set  s
+//  to the reverse complement of the region.  Return  true  if  id  is
+//  in the index; false, otherwise.  Takes time proportional to the
+//  length of the region.
+
+  {
+   const Fasta_Index_Entry_t  * e;
+   long int  col, i, j, line, n, pos;
+
+   s . erase ();
+
+   e = Find (id);
+   if  (e == NULL)
+       return  false;
+
+   lo = Max (lo, 0L);
+   hi = Min (hi, e -> len);
+   if  (hi <= lo)
+       return  true;
+
+   s . reserve (hi - lo);
+   for  (pos = lo;  pos < hi;  pos += n)
+     {
+      line = pos / e -> line_bases;
+      col = pos % e -> line_bases;
+      n = Min (hi - pos, e -> line_bases - col);
+      s . append (data + e -> offset + line * e -> line_bytes + col, n);
+     }
+
+   if  (strand == '-')
+       {
+        n = s . length ();
+        for  (i = 0, j = n - 1;  i < j;  i ++, j --)
+          {
+           char  ch = s [j];
+
+           s [j] = COMPLEMENT_TABLE [(unsigned char) s [i]];
+           s [i] = COMPLEMENT_TABLE [(unsigned char) ch];
+          }
+        if  (i == j)
+            s [i] = COMPLEMENT_TABLE [(unsigned char) s [i]];
+       }
+
+   return  true;
+  }
+
+
+
+const Fasta_Index_Entry_t *  Fasta_Index_t :: Find
+    (const char * id)
+
+//  Return the index entry of the sequence named  id , or  NULL
+//  if there is none.
+
+  {
+   map <string, int> :: const_iterator  p;
+
+   p = lookup . find (id);
+   if  (p == lookup . end ())
+       return  NULL;
+
+   return  & entry [p -> second];
+  }
+
+
+
+void  Fasta_Index_t :: Open
+    (const char * fname)
+
+//  Map the fasta file  fname  into memory and get its index, reading
+//  fname.fai  if it's at least as new as  fname , to the nanosecond,
+//  and otherwise building it and trying to save it there.
+
+  {
+   struct stat  fasta_stat, fai_stat;
+   string  fai_name;
+   int  fd;
+
+   filename = fname;
+   fai_name = filename + ".fai";
+
+   fd = open (fname, O_RDONLY);
+   if  (fd < 0 || fstat (fd, & fasta_stat) != 0)
+       {
+        sprintf (Clean_Exit_Msg_Line, "ERROR:  Could not open file  %s", fname);
+        Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+       }
+
+   data_len = fasta_stat . st_size;
+   if  (0 < data_len)
+       {
+        data = (const char *) mmap (NULL, data_len, PROT_READ, MAP_PRIVATE,
+                    fd, 0);
+        if  (data == MAP_FAILED)
+            {
+             sprintf (Clean_Exit_Msg_Line, "ERROR:  Could not map file  %s",
+                  fname);
+             Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+            }
+       }
+   close (fd);
+
+   if  (stat (fai_name . c_str (), & fai_stat) == 0
+          && (fasta_stat . st_mtim . tv_sec < fai_stat . st_mtim . tv_sec
+                || (fasta_stat . st_mtim . tv_sec == fai_stat . st_mtim . tv_sec
+                      && fasta_stat . st_mtim . tv_nsec
+                           <= fai_stat . st_mtim . tv_nsec))
+          && Read_Index (fai_name))
+       return;
+
+   entry . clear ();
+   lookup . clear ();
+   Build ();
+   Write_Index (fai_name);
+
+   return;
+  }
+
+
+
+bool  Fasta_Index_t :: Read_Index
+    (const string & fai_name)
+
+//  Read the index from file  fai_name .  Return  true  if it's
+//  read successfully and consistent with the mapped file, i.e., each
+//  sequence starts right after a line end and ends inside the file;
+//  false, otherwise, in which case it should be rebuilt.
+
+  {
+   FILE  * fp;
+   Fasta_Index_Entry_t  e;
+   char  line [MAX_FAI_LINE], id [MAX_FAI_LINE];
+   bool  ok = true;
+
+   fp = fopen (fai_name . c_str (), "r");
+   if  (fp == NULL)
+       return  false;
+
+   while  (ok && fgets (line, MAX_FAI_LINE, fp) != NULL)
+     {
+      ok = (sscanf (line, "%s %ld %ld %ld %ld", id, & e . len, & e . offset,
+                & e . line_bases, & e . line_bytes) == 5
+              && (e . len == 0
+                    || (0 < e . line_bases && e . line_bases <= e . line_bytes))
+              && 0 <= e . offset && e . offset <= long (data_len));
+      if  (ok)
+          ok = ((0 < e . offset && data [e . offset - 1] == '\n')
+                  || (e . len == 0 && e . offset == long (data_len)));
+      if  (ok && 0 < e . len)
+          ok = (e . offset + ((e . len - 1) / e . line_bases) * e . line_bytes
+                  + (e . len - 1) % e . line_bases < long (data_len));
+      if  (ok)
+          {
+           e . id = id;
+           Add_Entry (e);
+          }
+     }
+
+   fclose (fp);
+
+   return  ok;
+  }
+
+
+
+void  Fasta_Index_t :: Write_Index
+    (const string & fai_name)
+
+//  Write the index to file  fai_name  in  .fai  format.  If the
+//  file can't be written, e.g., the directory is read-only, just
+//  go on without it.
+
+  {
+   FILE  * fp;
+   int  i, n;
+
+   fp = fopen (fai_name . c_str (), "w");
+   if  (fp == NULL)
+       return;
+
+   n = entry . size ();
+   for  (i = 0;  i < n;  i ++)
+     fprintf (fp, "%s\t%ld\t%ld\t%ld\t%ld\n", entry [i] . id . c_str (),
+          entry [i] . len, entry [i] . offset, entry [i] . line_bases,
+          entry [i] . line_bytes);
+
+   fclose (fp);
+
+   return;
+  }
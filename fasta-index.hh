@@ -0,0 +1,81 @@
+//  A. L. Delcher
+//
+//  File:  fasta-index.hh
+//
+//  Last Modified:  19 Oct 2026
+//
+//  Random access to regions of the sequences in a fasta file
+//  using a samtools-style  .fai  index
+
+
+#ifndef  __FASTA_INDEX_H_INCLUDED
+#define  __FASTA_INDEX_H_INCLUDED
+
+
+#include  "delcher.hh"
+#include  <string>
+#include  <vector>
+
+
+const int  MAX_FAI_LINE = 10000;
+  // Longest line allowed in a  .fai  file
+
+
+struct  Fasta_Index_Entry_t
+  {
+   string  id;
+     // first word of the header line
+   long int  len;
+     // number of bases in the sequence
+   long int  offset;
+     // position in the file of the first base
+   long int  line_bases, line_bytes;
+     // bases on each full line, and bytes including the line end
+  };
+
+
+class  Fasta_Index_t
+  {
+   // A fasta file mapped into memory with the position and line layout
+   // of each of its sequences, so any region can be extracted without
+   // reading anything else.  The index is the same as the  .fai  file
+   // of  samtools faidx .  It's read from  <file>.fai  if that is up to
+   // date, and otherwise built and saved there.  Every line of a
+   // sequence but its last must have the same length.
+   private:
+     string  filename;
+     const char  * data;
+     size_t  data_len;
+       // the fasta file as mapped into memory
+     vector <Fasta_Index_Entry_t>  entry;
+     map <string, int>  lookup;
+       // subscript in  entry  of each id
+
+     void  Add_Entry
+         (const Fasta_Index_Entry_t & e);
+     void  Build
+         (void);
+     bool  Read_Index
+         (const string & fai_name);
+     void  Write_Index
+         (const string & fai_name);
+
+   public:
+     Fasta_Index_t
+         ();
+     ~ Fasta_Index_t
+         ();
+     bool  Extract
+         (string & s, const char * id, long int lo, long int hi,
+          char strand = '+');
+     const Fasta_Index_Entry_t *  Find
+         (const char * id);
+     int  Num_Seqs
+         (void)
+       { return  int (entry . size ()); }
+     void  Open
+         (const char * fname);
+  };
+
+
+#endif
@@ -2,42 +2,127 @@
 //
 //  File:  fasta.cc
 //
-//  Last Modified:  23 October 2003
+//  Last Modified:  19 Oct 2026
 //
 //  Routines to manipulate FASTA format files
 
 
 #include  "fasta.hh"
 
+#include  <zlib.h>
 
 
-void  Fasta_Print
-    (FILE * fp, const char * s, const char * hdr, int fasta_width)
 
-//  Print string  s  in fasta format to  fp .  Put string  hdr
-//  on header line, unless it's  NULL  in which case do not print
-//  a header line at all.  Print at most  fasta_width  characters per
-//  line.
+static void  Append_Non_Space
+    (string & s, const char * p, size_t n)
+
+//  Append the non-whitespace characters in  p [0 .. (n - 1)]  to
+//  string  s .  Sequence lines normally have no whitespace except
+//  the newline at the end, so copy each line as a single block
+//  unless it has some other control or space character in it.
 
   {
-   int  ct = 0;
+   const char  * end = p + n;
 
-   if  (hdr != NULL)
-       fprintf (fp, ">%s\n", hdr);
+   while  (p < end)
+     {
+      const char  * eol;
+      size_t  i, len;
+
+      eol = (const char *) memchr (p, '\n', end - p);
+      if  (eol == NULL)
+          eol = end;
+      len = eol - p;
+
+      for  (i = 0;  i < len && ' ' < (unsigned char) p [i];  i ++)
+        ;
+      s . append (p, i);
+      for  ( ;  i < len;  i ++)
+        if  (! isspace ((unsigned char) p [i]))
+            s . push_back (p [i]);
+
+      if  (eol == end)
+          break;
+      p = eol + 1;
+     }
 
-   while  (* s != '\0')
+   return;
+  }
+
+
+
+static void  Print_Wrapped
+    (FILE * fp, const char * s, size_t n, int fasta_width, int & ct)
+
+//  Print  s [0 .. (n - 1)]  to  fp  continuing a fasta data line
+//  that already has  ct  characters on it, starting a new line
+//  before any character that would go past  fasta_width .  Each
+//  line's worth is written with a single  fwrite .  Set  ct  to the
+//  number of characters on the last line.  A  fasta_width  of zero
+//  or less means no limit.
+
+  {
+   size_t  room;
+
+   if  (fasta_width <= 0)
+       {
+        fwrite (s, 1, n, fp);
+        ct += n;
+        return;
+       }
+
+   while  (0 < n)
      {
       if  (ct == fasta_width)
           {
            fputc ('\n', fp);
            ct = 0;
           }
-      fputc (* s, fp);
-      s ++;
-      ct ++;
+      room = Min (n, size_t (fasta_width - ct));
+      fwrite (s, 1, room, fp);
+      s += room;
+      n -= room;
+      ct += room;
      }
 
-   fputc ('\n', fp);
+   return;
+  }
+
+
+
+void  Fasta_Buffer_Output
+    (FILE * fp, size_t size)
+
+//  Give  fp  a fully buffered output buffer of  size  bytes, so that
+//  the many small writes of fasta output become few large system
+//  calls.  Must be called before anything is written to  fp .
+//  Terminals are left as they are, so output still appears promptly.
+
+  {
+   static char  * buff;
+     // static so the buffer stays reachable while  fp  is open
+
+   if  (isatty (fileno (fp)))
+       return;
+
+   buff = (char *) SAFE_MALLOC (size);
+   setvbuf (fp, buff, _IOFBF, size);
+
+   return;
+  }
+
+
+
+void  Fasta_Print
+    (FILE * fp, const char * s, const char * hdr, int fasta_width)
+
+//  Print string  s  in fasta format to  fp .  Put string  hdr
+//  on header line, unless it's  NULL  in which case do not print
+//  a header line at all.  Print at most  fasta_width  characters per
+//  line.
+
+  {
+   Fasta_Print_N (fp, s, strlen (s), hdr, fasta_width);
 
    return;
   }
@@ -52,21 +137,13 @@ void  Fasta_Print_N
 //  characters per line.
 
   {
-   int  ct = 0, i;
+   int  ct = 0;
 
    if  (hdr != NULL)
        fprintf (fp, ">%s\n", hdr);
 
-   for  (i = 0;  i < n;  i ++)
-     {
-      if  (ct == fasta_width)
-          {
-           fputc ('\n', fp);
-           ct = 0;
-          }
-      fputc (s [i], fp);
-      ct ++;
-     }
+   if  (0 < n)
+       Print_Wrapped (fp, s, n, fasta_width, ct);
 
    fputc ('\n', fp);
 
@@ -86,24 +163,27 @@ void  Fasta_Print_Skip
 //  line.
 
   {
+   bool  omit [256] = {false};
+   const char  * p;
    int  ct = 0;
 
+   // the terminating '\0' is omitted too so the scans below stop there
+   for  (p = skip;  * p != '\0';  p ++)
+     omit [(unsigned char) * p] = true;
+   omit [0] = true;
+
    if  (hdr != NULL)
        fprintf (fp, ">%s\n", hdr);
 
    while  (* s != '\0')
      {
-      if  (strchr (skip, * s) == NULL)
-          {
-           if  (ct == fasta_width)
-               {
-                fputc ('\n', fp);
-                ct = 0;
-               }
-           fputc (* s, fp);
-           ct ++;
-          }
-      s ++;
+      // print the run of characters up to the next omitted one
+      for  (p = s;  ! omit [(unsigned char) * p];  p ++)
+        ;
+      Print_Wrapped (fp, s, p - s, fasta_width, ct);
+
+      for  (s = p;  * s != '\0' && omit [(unsigned char) * s];  s ++)
+        ;
      }
 
    fputc ('\n', fp);
@@ -113,6 +193,78 @@ void  Fasta_Print_Skip
 
 
 
+void  Fastq_Print
+    (FILE * fp, const char * s, const char * q, const char * hdr)
+
+//  Print string  s  with quality characters  q  (which must be the
+//  same length) as a 4-line fastq record to  fp  with header  hdr .
+
+  {
+   fprintf (fp, "@%s\n%s\n+\n%s\n", hdr, s, q);
+
+   return;
+  }
+
+
+
+bool  Fastq_Read
+    (FILE * fp, string & s, string & q, string & hdr)
+
+//  Read next fastq-format record from file  fp  (which must
+//  already be open) into string  s  and its quality characters
+//  into string  q .  Put the header line (without the '@' and
+//  leading spaces) into string  hdr .  Sequence and quality may
+//  be split over several lines.  Return  true  if a complete record
+//  is successfully read; false, otherwise.
+
+  {
+   int  ch;
+
+   s . erase ();
+   q . erase ();
+   hdr . erase ();
+
+   // skip till next '@' if necessary
+   while  ((ch = fgetc (fp)) != EOF && ch != '@')
+     ;
+
+   if  (ch == EOF)
+       return  false;
+
+   // skip spaces if any
+   while  ((ch = fgetc (fp)) != EOF && ch == ' ')
+     ;
+   if  (ch == EOF)
+       return  false;
+   ungetc (ch, fp);
+
+   // put rest of line into  hdr
+   while  ((ch = fgetc (fp)) != EOF && ch != '\n')
+     hdr . push_back (char (ch));
+
+   // put everything up till the '+' separator line into  s
+   while  ((ch = fgetc (fp)) != EOF && ch != '+')
+     {
+      if  (! isspace (ch))
+          s . push_back (char (ch));
+     }
+
+   // skip rest of separator line
+   while  (ch != EOF && ch != '\n')
+     ch = fgetc (fp);
+
+   // quality characters may include '@' so count them to find the end
+   while  (q . length () < s . length () && (ch = fgetc (fp)) != EOF)
+     {
+      if  (! isspace (ch))
+          q . push_back (char (ch));
+     }
+
+   return  (q . length () == s . length ());
+  }
+
+
+
 bool  Fasta_Qual_Read
     (FILE * fp, string & q, string & hdr)
 
@@ -121,9 +273,13 @@ bool  Fasta_Qual_Read
 //  (encoded by adding the quality value to the  QUALITY_OFFSET  value).
 //  Put the faster header line (without the '>' and trailing spaces) into
 //  string  hdr .  Return  true  if a string is successfully,
-//  read; false, otherwise.
+//  read; false, otherwise.  Like  Fasta_Read  reads no further
+//  into  fp  than the '>' starting the next record.
 
   {
+   char  * buff = NULL;
+   size_t  buff_size = 0;
+   ssize_t  i, n;
    bool  have_value;
    int  ch, val;
 
@@ -131,28 +287,43 @@ bool  Fasta_Qual_Read
    hdr . erase ();
 
    // skip till next '>' if necessary
-   while  ((ch = fgetc (fp)) != EOF && ch != '>')
-     ;
-
-   if  (ch == EOF)
-       return  false;
+   n = getdelim (& buff, & buff_size, '>', fp);
+   if  (n <= 0 || buff [n - 1] != '>')
+       {
+        free (buff);
+        return  false;
+       }
 
    // skip spaces if any
    while  ((ch = fgetc (fp)) != EOF && ch == ' ')
      ;
    if  (ch == EOF)
-       return  false;
+       {
+        free (buff);
+        return  false;
+       }
    ungetc (ch, fp);
 
    // put rest of line into  hdr
-   while  ((ch = fgetc (fp)) != EOF && ch != '\n')
-     hdr . push_back (char (ch));
-
-   // put all numbers up till next '>' into  q
+   n = getline (& buff, & buff_size, fp);
+   if  (0 < n && buff [n - 1] == '\n')
+       n --;
+   if  (0 < n)
+       hdr . assign (buff, n);
+
+   // put all numbers up till next '>' into  q .  A value is only
+   // complete when whitespace follows it.
+   n = getdelim (& buff, & buff_size, '>', fp);
+   if  (0 < n && buff [n - 1] == '>')
+       {
+        n --;
+        ungetc ('>', fp);
+       }
    have_value = false;
    val = 0;
-   while  ((ch = fgetc (fp)) != EOF && ch != '>')
+   for  (i = 0;  i < n;  i ++)
      {
+      ch = (unsigned char) buff [i];
       if  (isspace (ch))
           {
            if  (have_value)
@@ -167,8 +338,7 @@ bool  Fasta_Qual_Read
           }
      }
 
-   if  (ch == '>')
-       ungetc (ch, fp);
+   free (buff);
 
    return  true;
   }
@@ -182,44 +352,459 @@ bool  Fasta_Read
 //  already be open) into string  s .  Put the faster
 //  header line (without the '>' and trailing spaces) into
 //  string  hdr .  Return  true  if a string is successfully,
-//  read; false, otherwise.
+//  read; false, otherwise.  Reads no further into  fp  than the
+//  '>' starting the next record, so other routines can continue
+//  reading  fp  afterwards.  Use a  Seq_Reader_t  for faster
+//  reading of whole files.
 
   {
+   char  * buff = NULL;
+   size_t  buff_size = 0;
+   ssize_t  n;
    int  ch;
 
    s . erase ();
    hdr . erase ();
 
    // skip till next '>' if necessary
-   while  ((ch = fgetc (fp)) != EOF && ch != '>')
-     ;
-
-   if  (ch == EOF)
-       return  false;
+   n = getdelim (& buff, & buff_size, '>', fp);
+   if  (n <= 0 || buff [n - 1] != '>')
+       {
+        free (buff);
+        return  false;
+       }
 
    // skip spaces if any
    while  ((ch = fgetc (fp)) != EOF && ch == ' ')
      ;
    if  (ch == EOF)
-       return  false;
+       {
+        free (buff);
+        return  false;
+       }
    ungetc (ch, fp);
 
    // put rest of line into  hdr
-   while  ((ch = fgetc (fp)) != EOF && ch != '\n')
-     hdr . push_back (char (ch));
+   n = getline (& buff, & buff_size, fp);
+   if  (0 < n && buff [n - 1] == '\n')
+       n --;
+   if  (0 < n)
+       hdr . assign (buff, n);
 
    // put everything up till next '>' into  s
-   while  ((ch = fgetc (fp)) != EOF && ch != '>')
+   n = getdelim (& buff, & buff_size, '>', fp);
+   if  (0 < n && buff [n - 1] == '>')
+       {
+        n --;
+        ungetc ('>', fp);
+       }
+   if  (0 < n)
+       Append_Non_Space (s, buff, n);
+
+   free (buff);
+
+   return  true;
+  }
+
+
+
+Seq_Reader_t :: Seq_Reader_t
+    (FILE * f, size_t size)
+
+//  Set up to read fasta or fastq records from file  f  (which must
+//  already be open) in blocks of  size  bytes.  Read the first block
+//  to see if it's gzip-compressed and, if so, start the thread to
+//  inflate it.  Then check whether the first record is fastq.
+
+  {
+   int  i;
+
+   fp = f;
+   block_size = Max (size, size_t (2));
+     // enough to see the gzip magic number
+   raw = (char *) SAFE_MALLOC (block_size);
+   raw_len = fread (raw, 1, block_size, fp);
+   gzipped = (2 <= raw_len && (unsigned char) raw [0] == 0x1f
+                && (unsigned char) raw [1] == 0x8b);
+
+   holding = done = stop = false;
+   head = count = 0;
+   if  (gzipped)
+       {
+        for  (i = 0;  i < SEQ_READ_BLOCKS;  i ++)
+          block . push_back ((char *) SAFE_MALLOC (block_size));
+        block_len . resize (SEQ_READ_BLOCKS, 0);
+        buff = NULL;
+        lo = hi = 0;
+        inflater = std :: thread (& Seq_Reader_t :: Inflate_Loop, this);
+       }
+     else
+       {
+        buff = raw;
+        lo = 0;
+        hi = raw_len;
+       }
+
+   // a fastq file starts with '@' after any whitespace
+   fastq = false;
+   while  (lo < hi || Fill ())
      {
-      if  (! isspace (ch))
-          s . push_back (char (ch));
+      while  (lo < hi && isspace ((unsigned char) buff [lo]))
+        lo ++;
+      if  (lo < hi)
+          {
+           fastq = (buff [lo] == '@');
+           break;
+          }
+     }
+  }
+
+
+
+Seq_Reader_t :: ~ Seq_Reader_t
+    ()
+
+  {
+   int  i;
+
+   if  (gzipped)
+       {
+        {
+         std :: unique_lock <std :: mutex>  guard (lock);
+
+         stop = true;
+         changed . notify_all ();
+        }
+        inflater . join ();
+        for  (i = 0;  i < SEQ_READ_BLOCKS;  i ++)
+          free (block [i]);
+       }
+   free (raw);
+  }
+
+
+
+void  Seq_Reader_t :: Append_Line
+    (string & s)
+
+//  Append the rest of the current line to  s  and move past
+//  the newline at its end.
+
+  {
+   const char  * p;
+
+   while  (lo < hi || Fill ())
+     {
+      p = (const char *) memchr (buff + lo, '\n', hi - lo);
+      if  (p != NULL)
+          {
+           s . append (buff + lo, p - (buff + lo));
+           lo = p + 1 - buff;
+           return;
+          }
+      s . append (buff + lo, hi - lo);
+      lo = hi;
+     }
+
+   return;
+  }
+
+
+
+void  Seq_Reader_t :: Append_Until
+    (string & s, char ch)
+
+//  Append the non-whitespace characters up to the next  ch
+//  (or the end of the file) to  s .  Leave  ch  unread.
+
+  {
+   const char  * p;
+   size_t  end;
+
+   while  (lo < hi || Fill ())
+     {
+      p = (const char *) memchr (buff + lo, ch, hi - lo);
+      end = (p == NULL ? hi : p - buff);
+      Append_Non_Space (s, buff + lo, end - lo);
+      lo = end;
+      if  (p != NULL)
+          return;
      }
 
-   if  (ch == '>')
-       ungetc (ch, fp);
+   return;
+  }
+
+
+
+bool  Seq_Reader_t :: Fill
+    (void)
+
+//  Make  buff  the next block of the file, inflated if it's
+//  compressed.  Only called when all of the current block has
+//  been used.  Return  true  if there is one; false at the end
+//  of the file.
+
+  {
+   lo = hi = 0;
+
+   if  (! gzipped)
+       {
+        hi = fread (buff, 1, block_size, fp);
+        return  (0 < hi);
+       }
+
+   std :: unique_lock <std :: mutex>  guard (lock);
+
+   if  (holding)
+       {
+        head = (head + 1) % SEQ_READ_BLOCKS;
+        count --;
+        holding = false;
+        changed . notify_all ();
+       }
+
+   while  (count == 0 && ! done)
+     changed . wait (guard);
+   if  (count == 0)
+       return  false;
+
+   buff = block [head];
+   hi = block_len [head];
+   holding = true;
 
    return  true;
   }
 
 
 
+void  Seq_Reader_t :: Inflate_Loop
+    (void)
+
+//  Run by the inflate thread.  Inflate the gzip data in  fp ,
+//  starting with the  raw_len  bytes already in  raw , into the
+//  free blocks of the queue.  Concatenated gzip members, as made
+//  by  bgzip  or  cat  of several files, are inflated one after another.
+
+  {
+   z_stream  zs;
+   bool  at_end, member_done;
+   int  slot, ret;
+
+   memset (& zs, 0, sizeof (zs));
+   if  (inflateInit2 (& zs, 15 + 32) != Z_OK)
+       Clean_Exit ("ERROR:  Could not initialize zlib", __FILE__, __LINE__);
+   zs . next_in = (Bytef *) raw;
+   zs . avail_in = raw_len;
+
+   at_end = member_done = false;
+   while  (! at_end)
+     {
+      {
+       std :: unique_lock <std :: mutex>  guard (lock);
+
+       while  (count == SEQ_READ_BLOCKS && ! stop)
+         changed . wait (guard);
+       if  (stop)
+           break;
+       slot = (head + count) % SEQ_READ_BLOCKS;
+      }
+
+      zs . next_out = (Bytef *) block [slot];
+      zs . avail_out = block_size;
+      while  (0 < zs . avail_out)
+        {
+         if  (zs . avail_in == 0)
+             {
+              raw_len = fread (raw, 1, block_size, fp);
+              if  (raw_len == 0)
+                  {
+                   at_end = true;
+                   break;
+                  }
+              zs . next_in = (Bytef *) raw;
+              zs . avail_in = raw_len;
+             }
+         if  (member_done)
+             {
+              inflateReset (& zs);
+              member_done = false;
+             }
+
+         ret = inflate (& zs, Z_NO_FLUSH);
+         if  (ret == Z_STREAM_END)
+             member_done = true;
+         else if  (ret != Z_OK)
+             {
+              sprintf (Clean_Exit_Msg_Line,
+                   "ERROR:  Bad compressed input:  %s",
+                   zs . msg == NULL ? "unknown zlib error" : zs . msg);
+              Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+             }
+        }
+
+      if  (at_end && ! member_done)
+          Clean_Exit ("ERROR:  Compressed input ends unexpectedly",
+               __FILE__, __LINE__);
+
+      {
+       std :: unique_lock <std :: mutex>  guard (lock);
+
+       block_len [slot] = block_size - zs . avail_out;
+       if  (0 < block_len [slot])
+           count ++;
+       done = at_end;
+       changed . notify_all ();
+      }
+     }
+
+   inflateEnd (& zs);
+
+   return;
+  }
+
+
+
+bool  Seq_Reader_t :: Next
+    (string & s, string & hdr)
+
+//  Read the next record into string  s  and its header line into
+//  string  hdr , discarding its qualities if it's fastq.  Return
+//  true  if a record is successfully read; false, otherwise.
+
+  {
+   return  Next (s, qual, hdr);
+  }
+
+
+
+bool  Seq_Reader_t :: Next
+    (string & s, string & q, string & hdr)
+
+//  Read the next record into string  s  and its header line into
+//  string  hdr  exactly as  Fasta_Read  or  Fastq_Read  does.  Put
+//  its quality characters into  q , which is left empty for fasta.
+//  Return  true  if a record is successfully read; false, otherwise.
+
+  {
+   if  (fastq)
+       return  Next_Fastq (s, q, hdr);
+
+   q . erase ();
+   return  Next_Fasta (s, hdr);
+  }
+
+
+
+bool  Seq_Reader_t :: Next_Fasta
+    (string & s, string & hdr)
+
+//  Read the next fasta-format string into string  s  and its
+//  header line (without the '>' and leading spaces) into string  hdr
+//  exactly as  Fasta_Read  does.  Return  true  if a string is
+//  successfully read; false, otherwise.
+
+  {
+   s . erase ();
+   hdr . erase ();
+
+   if  (! Skip_Past ('>') || ! Skip_Spaces ())
+       return  false;
+
+   Append_Line (hdr);
+   Append_Until (s, '>');
+
+   return  true;
+  }
+
+
+
+bool  Seq_Reader_t :: Next_Fastq
+    (string & s, string & q, string & hdr)
+
+//  Read the next fastq record into string  s , its quality
+//  characters into string  q  and its header line (without the '@'
+//  and leading spaces) into string  hdr  exactly as  Fastq_Read  does.
+//  Return  true  if a record is successfully read; false if there
+//  are no more.  Exit with a message if the input ends before a
+//  record's qualities do, rather than silently dropping it.
+
+  {
+   size_t  len;
+
+   s . erase ();
+   q . erase ();
+   hdr . erase ();
+
+   if  (! Skip_Past ('@') || ! Skip_Spaces ())
+       return  false;
+
+   Append_Line (hdr);
+   Append_Until (s, '+');
+
+   // skip the separator line
+   Skip_Past ('\n');
+
+   // quality characters may include '@' so count them to find the end
+   len = s . length ();
+   while  (q . length () < len && (lo < hi || Fill ()))
+     {
+      for  ( ;  lo < hi && q . length () < len;  lo ++)
+        if  (! isspace ((unsigned char) buff [lo]))
+            q . push_back (buff [lo]);
+     }
+
+   if  (q . length () < len)
+       {
+        sprintf (Clean_Exit_Msg_Line,
+             "ERROR:  Fastq record %.200s has %lu quality characters for %lu bases",
+             hdr . c_str (), (long unsigned) q . length (), (long unsigned) len);
+        Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+       }
+
+   return  true;
+  }
+
+
+
+bool  Seq_Reader_t :: Skip_Past
+    (char ch)
+
+//  Move past the next occurrence of  ch .  Return  true  if
+//  there is one; false, otherwise.
+
+  {
+   const char  * p;
+
+   while  (lo < hi || Fill ())
+     {
+      p = (const char *) memchr (buff + lo, ch, hi - lo);
+      if  (p != NULL)
+          {
+           lo = p + 1 - buff;
+           return  true;
+          }
+      lo = hi;
+     }
+
+   return  false;
+  }
+
+
+
+bool  Seq_Reader_t :: Skip_Spaces
+    (void)
+
+//  Move past any spaces.  Return  true  if there's anything
+//  after them; false at the end of the file.
+
+  {
+   while  (lo < hi || Fill ())
+     {
+      while  (lo < hi && buff [lo] == ' ')
+        lo ++;
+      if  (lo < hi)
+          return  true;
+     }
+
+   return  false;
+  }
@@ -2,7 +2,7 @@
 //
 //  File:  fasta.hh
 //
-//  Last Modified:  23 October 2003
+//  Last Modified:  19 Oct 2026
 //
 //  Routines to manipulate FASTA format files
 
@@ -14,14 +14,97 @@
 #include  "delcher.hh"
 #include  <string>
 #include  <vector>
+#include  <unistd.h>
+#include  <condition_variable>
+#include  <mutex>
+#include  <thread>
 
 
 const int  DEFAULT_FASTA_WIDTH = 60;
   // Max number of characters to print on a FASTA data line
 const char  QUALITY_OFFSET = '0';
   // Value added to qualities to create a printable character
+const char  FASTQ_QUALITY_OFFSET = '!';
+  // Value added to phred qualities to make fastq quality characters
+const size_t  SEQ_READ_BLOCK = (1 << 22);
+  // Number of bytes  Seq_Reader_t  reads from its file, and inflates
+  // from a compressed file, at a time
+const int  SEQ_READ_BLOCKS = 4;
+  // Number of inflated blocks  Seq_Reader_t  queues ahead of the parsing
+const size_t  FASTA_WRITE_BUFFER = (1 << 20);
+  // Size of the output buffer set by  Fasta_Buffer_Output
 
 
+class  Seq_Reader_t
+  {
+   // Reads fasta or fastq records from a file that may be gzip-compressed.
+   // Both the format and the compression are detected from the start of
+   // the file.  The file is read in large blocks, finding line and record
+   // boundaries with  memchr  instead of going a character at a time
+   // through  stdio .  A compressed file is inflated by a separate thread,
+   // which keeps up to  SEQ_READ_BLOCKS  blocks ready ahead of the parsing.
+   // It reads ahead, so nothing else should read the file while it's in use.
+   private:
+     FILE  * fp;
+     char  * buff;
+     size_t  lo, hi;
+       // the unread part of the current block is  buff [lo .. (hi - 1)]
+     size_t  block_size;
+     char  * raw;
+     size_t  raw_len;
+       // the block read directly from  fp , which is  buff  for a plain file
+       // and the compressed input of the inflate thread for a gzip file
+     bool  fastq, gzipped;
+     string  qual;
+       // qualities of fastq records read without asking for them
+
+     vector <char *>  block;
+     vector <size_t>  block_len;
+     int  head, count;
+       // the inflate thread's output blocks are a circular queue:
+       //  count  blocks starting at  block [head]  are full
+     bool  holding;
+       // true if  buff  is  block [head]  and it hasn't been released
+     bool  done, stop;
+       // set when the inflate thread has finished, and to tell it to quit
+     std :: mutex  lock;
+     std :: condition_variable  changed;
+     std :: thread  inflater;
+
+     void  Append_Line
+         (string & s);
+     void  Append_Until
+         (string & s, char ch);
+     bool  Fill
+         (void);
+     void  Inflate_Loop
+         (void);
+     bool  Next_Fasta
+         (string & s, string & hdr);
+     bool  Next_Fastq
+         (string & s, string & q, string & hdr);
+     bool  Skip_Past
+         (char ch);
+     bool  Skip_Spaces
+         (void);
+
+   public:
+     Seq_Reader_t
+         (FILE * f, size_t block_size = SEQ_READ_BLOCK);
+     ~ Seq_Reader_t
+         ();
+     bool  Is_Fastq
+         (void)
+       { return  fastq; }
+     bool  Next
+         (string & s, string & hdr);
+     bool  Next
+         (string & s, string & q, string & hdr);
+  };
+
+
+void  Fasta_Buffer_Output
+    (FILE * fp, size_t size = FASTA_WRITE_BUFFER);
 void  Fasta_Print
     (FILE * fp, const char * s, const char * hdr = NULL,
      int fasta_width = DEFAULT_FASTA_WIDTH);
@@ -31,6 +114,10 @@ void  Fasta_Print_N
 void  Fasta_Print_Skip
     (FILE * fp, const char * s, const char * skip, const char * hdr = NULL,
      int fasta_width = DEFAULT_FASTA_WIDTH);
+void  Fastq_Print
+    (FILE * fp, const char * s, const char * q, const char * hdr);
+bool  Fastq_Read
+    (FILE * fp, string & s, string & q, string & hdr);
 bool  Fasta_Qual_Read
     (FILE * fp, string & q, string & hdr);
 bool  Fasta_Read
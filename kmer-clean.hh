@@ -0,0 +1,459 @@
+//  A. L. Delcher
+//
+//  File:  kmer-clean.hh
+//
+//  Last Modified:  19 Oct 2026
+//
+//  Declarations for removing sequencing-error tips and bubbles from
+//  the de Bruijn graph of the kmers in a Kmer_Hash_t.  The info type
+//  of the hash must have a  freq  field and a  removed  bit.  Kmers are
+//  only flagged as removed, not deleted, so callers must treat a
+//  flagged kmer as absent.
+
+
+#ifndef  __KMER_CLEAN_HH_INCLUDED
+#define  __KMER_CLEAN_HH_INCLUDED
+
+#include  "delcher.hh"
+#include  "kmer-hash.hh"
+
+
+const double  DEFAULT_CLEAN_FREQ_RATIO = 0.25;
+  // A tip or bubble branch is removed only if its kmer frequencies are
+  // below this fraction of the frequencies of the path it leaves
+const int  MAX_KMER_STRING = 128;
+  // Size of buffers for kmer strings; longer than any kmer a
+  // Kmer_Hash_t can hold
+const int  MAX_CLEAN_ROUNDS = 10;
+  // Most times tip clipping and bubble popping are repeated, since
+  // each removal can expose new tips
+
+
+void  Reverse_Complement
+  (char * s);
+
+
+template <class DT> class Kmer_Cleaner_t
+{
+private:
+  Kmer_Hash_t <DT>  * hash;
+  int  kmer_len;
+  double  freq_ratio;
+  char  * tmp, * rmer;
+
+  void  Follow_Branch
+    (const char * s, int max_len, vector <DT *> & branch, char * end_mer);
+  int  Try_Bubble
+    (const char * s, int max_len);
+  int  Try_Tip
+    (const char * s, int max_len);
+
+public:
+  Kmer_Cleaner_t
+    (Kmer_Hash_t <DT> * h, int k, double r = DEFAULT_CLEAN_FREQ_RATIO);
+  ~ Kmer_Cleaner_t ();
+  void  Clean
+    (int max_tip_len, int max_bubble_len, long unsigned & tip_mers,
+     long unsigned & bubble_mers);
+  long unsigned  Clip_Tips
+    (int max_len);
+  DT *  Lookup
+    (const char * s);
+  long unsigned  Pop_Bubbles
+    (int max_len);
+  int  Predecessors
+    (const char * s, char ch [], unsigned freq [] = NULL);
+  int  Successors
+    (const char * s, char ch [], unsigned freq [] = NULL);
+};
+
+
+template <class DT> void  Print_If_Kept
+  (FILE * fp, const char * s, const DT & info)
+
+// Print string s and info . freq to fp, in the same format as
+// 'jellyfish dump -c', if info . removed is false.
+
+{
+  if (! info . removed)
+    fprintf (fp, "%s %d\n", s, int (info . freq));
+
+  return;
+}
+
+
+template <class DT> Kmer_Cleaner_t <DT> :: Kmer_Cleaner_t
+  (Kmer_Hash_t <DT> * h, int k, double r)
+
+// Construct a cleaner for the kmers of length k in hash h that removes
+// tips and bubble branches whose frequencies are below r times those
+// of the path they branch from.
+
+{
+  assert (k < MAX_KMER_STRING);
+  hash = h;
+  kmer_len = k;
+  freq_ratio = r;
+  tmp = (char *) SAFE_MALLOC (kmer_len + 1);
+  rmer = (char *) SAFE_MALLOC (kmer_len + 1);
+}
+
+
+template <class DT> Kmer_Cleaner_t <DT> :: ~ Kmer_Cleaner_t ()
+
+// Destroy this cleaner
+
+{
+  free (tmp);
+  free (rmer);
+}
+
+
+template <class DT> void  Kmer_Cleaner_t <DT> :: Clean
+  (int max_tip_len, int max_bubble_len, long unsigned & tip_mers,
+   long unsigned & bubble_mers)
+
+// Alternately clip tips of at most max_tip_len kmers and pop bubbles
+// with branches of at most max_bubble_len kmers until nothing more is
+// removed or MAX_CLEAN_ROUNDS is reached.  A length of 0 turns that
+// kind of cleaning off.  Set tip_mers and bubble_mers to the number
+// of kmers removed of each kind.
+
+{
+  long unsigned  t, b;
+  int  round;
+
+  tip_mers = bubble_mers = 0;
+  for (round = 0; round < MAX_CLEAN_ROUNDS; round ++)
+    {
+      t = b = 0;
+      if (0 < max_tip_len)
+        t = Clip_Tips (max_tip_len);
+      if (0 < max_bubble_len)
+        b = Pop_Bubbles (max_bubble_len);
+      if (0 < Verbose)
+        fprintf (stderr, "Clean round %d:  %lu tip kmers  %lu bubble kmers\n",
+                 round + 1, t, b);
+      tip_mers += t;
+      bubble_mers += b;
+      if (t + b == 0)
+        break;
+    }
+
+  return;
+}
+
+
+template <class DT> long unsigned  Kmer_Cleaner_t <DT> :: Clip_Tips
+  (int max_len)
+
+// Flag as removed the kmers of every tip of at most max_len kmers.
+// A tip is a non-branching path that has no predecessor at one end
+// and at the other end joins a kmer that has another predecessor.
+// It's removed only if its highest kmer frequency is below freq_ratio
+// times that of the strongest other predecessor.  Return the number
+// of kmers removed.
+
+{
+  Binary_Mer_t  bin;
+  DT  * p;
+  char  * s;
+  long unsigned  ct = 0;
+  unsigned  i, n;
+  int  j;
+
+  s = (char *) SAFE_MALLOC (kmer_len + 1);
+
+  n = hash -> Num_Prefixes ();
+  for (i = 0; i < n; i ++)
+    for (j = 0; (p = hash -> Entry (i, j, bin)) != NULL; j ++)
+      {
+        if (p -> removed)
+          continue;
+        hash -> Binary_To_Kmer (bin, s, true);
+        ct += Try_Tip (s, max_len);
+        if (p -> removed)
+          continue;
+        Reverse_Complement (s);
+        ct += Try_Tip (s, max_len);
+      }
+
+  free (s);
+
+  return ct;
+}
+
+
+template <class DT> void  Kmer_Cleaner_t <DT> :: Follow_Branch
+  (const char * s, int max_len, vector <DT *> & branch, char * end_mer)
+
+// Follow the non-branching path that begins with kmer s (which must
+// have exactly one predecessor) for at most max_len kmers, putting
+// pointers to the info of its kmers in branch.  If the path ends at
+// a kmer with more than one predecessor, copy that kmer into end_mer;
+// otherwise (the path forks, dead-ends or is too long) set end_mer to
+// the empty string and clear branch.
+
+{
+  char  ch [4];
+  int  n;
+
+  branch . clear ();
+  end_mer [0] = '\0';
+  strcpy (tmp, s);
+
+  while (true)
+    {
+      if (1 < Predecessors (tmp, ch))
+        {
+          strcpy (end_mer, tmp);
+          return;
+        }
+      if ((int) branch . size () == max_len)
+        break;
+      branch . push_back (Lookup (tmp));
+      n = Successors (tmp, ch);
+      if (n != 1)
+        break;
+      memmove (tmp, tmp + 1, kmer_len - 1);
+      tmp [kmer_len - 1] = ch [0];
+    }
+
+  branch . clear ();
+
+  return;
+}
+
+
+template <class DT> DT *  Kmer_Cleaner_t <DT> :: Lookup
+  (const char * s)
+
+// Return a pointer to the info of kmer s (in either orientation) in
+// hash, or NULL if it's not there or has been removed.
+
+{
+  DT  * p;
+
+  strcpy (rmer, s);
+  Reverse_Complement (rmer);
+  p = hash -> Find (strcmp (s, rmer) < 0 ? s : rmer);
+  if (p == NULL || p -> removed)
+    return NULL;
+
+  return p;
+}
+
+
+template <class DT> long unsigned  Kmer_Cleaner_t <DT> :: Pop_Bubbles
+  (int max_len)
+
+// Flag as removed the kmers of weak branches of simple bubbles, i.e.,
+// non-branching paths of at most max_len kmers that leave the same
+// kmer and rejoin at the same kmer.  The branch with the highest mean
+// frequency is kept; each other one is removed if its mean frequency
+// is below freq_ratio times that.  Return the number of kmers removed.
+
+{
+  Binary_Mer_t  bin;
+  DT  * p;
+  char  * s;
+  long unsigned  ct = 0;
+  unsigned  i, n;
+  int  j;
+
+  s = (char *) SAFE_MALLOC (kmer_len + 1);
+
+  n = hash -> Num_Prefixes ();
+  for (i = 0; i < n; i ++)
+    for (j = 0; (p = hash -> Entry (i, j, bin)) != NULL; j ++)
+      {
+        if (p -> removed)
+          continue;
+        hash -> Binary_To_Kmer (bin, s, true);
+        ct += Try_Bubble (s, max_len);
+        Reverse_Complement (s);
+        ct += Try_Bubble (s, max_len);
+      }
+
+  free (s);
+
+  return ct;
+}
+
+
+template <class DT> int  Kmer_Cleaner_t <DT> :: Predecessors
+  (const char * s, char ch [], unsigned freq [])
+
+// Put in ch the characters that can be added to the front of kmer s
+// (dropping its last character) to make a kmer in hash that hasn't
+// been removed.  If freq isn't NULL put their frequencies in it.
+// Return the number found.
+
+{
+  DT  * p;
+  char  t [MAX_KMER_STRING];
+  int  i, n = 0;
+
+  memcpy (t + 1, s, kmer_len - 1);
+  t [kmer_len] = '\0';
+  for (i = 0; i < 4; i ++)
+    {
+      t [0] = "ACGT" [i];
+      p = Lookup (t);
+      if (p != NULL)
+        {
+          if (freq != NULL)
+            freq [n] = p -> freq;
+          ch [n ++] = t [0];
+        }
+    }
+
+  return n;
+}
+
+
+template <class DT> int  Kmer_Cleaner_t <DT> :: Successors
+  (const char * s, char ch [], unsigned freq [])
+
+// Put in ch the characters that can be added to the end of kmer s
+// (dropping its first character) to make a kmer in hash that hasn't
+// been removed.  If freq isn't NULL put their frequencies in it.
+// Return the number found.
+
+{
+  DT  * p;
+  char  t [MAX_KMER_STRING];
+  int  i, n = 0;
+
+  memcpy (t, s + 1, kmer_len - 1);
+  t [kmer_len] = '\0';
+  for (i = 0; i < 4; i ++)
+    {
+      t [kmer_len - 1] = "ACGT" [i];
+      p = Lookup (t);
+      if (p != NULL)
+        {
+          if (freq != NULL)
+            freq [n] = p -> freq;
+          ch [n ++] = t [kmer_len - 1];
+        }
+    }
+
+  return n;
+}
+
+
+template <class DT> int  Kmer_Cleaner_t <DT> :: Try_Bubble
+  (const char * s, int max_len)
+
+// If kmer s has more than one successor and two or more of the branches
+// from it are simple paths that rejoin at the same kmer within max_len
+// kmers, remove all but the strongest of those branches whose
+// mean frequency is below freq_ratio times the strongest.  Return the
+// number of kmers removed.
+
+{
+  vector <DT *>  branch [4];
+  char  end_mer [4][MAX_KMER_STRING];
+  char  first [MAX_KMER_STRING], ch [4];
+  double  mean [4];
+  int  best, ct = 0;
+  int  i, j, m, n;
+
+  n = Successors (s, ch);
+  if (n < 2)
+    return 0;
+
+  memcpy (first, s + 1, kmer_len - 1);
+  first [kmer_len] = '\0';
+  for (i = 0; i < n; i ++)
+    {
+      first [kmer_len - 1] = ch [i];
+      Follow_Branch (first, max_len, branch [i], end_mer [i]);
+      m = branch [i] . size ();
+      mean [i] = 0.0;
+      for (j = 0; j < m; j ++)
+        mean [i] += branch [i][j] -> freq;
+      if (0 < m)
+        mean [i] /= m;
+    }
+
+  for (i = 0; i < n; i ++)
+    {
+      if (branch [i] . empty ())
+        continue;
+
+      // find the strongest branch rejoining where this one does
+      best = i;
+      for (j = 0; j < n; j ++)
+        if (! branch [j] . empty () && strcmp (end_mer [i], end_mer [j]) == 0
+              && mean [best] < mean [j])
+          best = j;
+
+      if (best != i && mean [i] < freq_ratio * mean [best])
+        {
+          m = branch [i] . size ();
+          for (j = 0; j < m; j ++)
+            branch [i][j] -> removed = 1;
+          ct += m;
+          branch [i] . clear ();
+        }
+    }
+
+  return ct;
+}
+
+
+template <class DT> int  Kmer_Cleaner_t <DT> :: Try_Tip
+  (const char * s, int max_len)
+
+// If kmer s has no predecessors and starts a tip of at most max_len
+// kmers, as described in Clip_Tips, flag the kmers of the tip as
+// removed and return how many there are; otherwise, return 0.
+
+{
+  vector <DT *>  tip;
+  unsigned  freq [4], tip_max = 0, other_max;
+  char  ch [4];
+  int  i, n;
+
+  if (0 < Predecessors (s, ch))
+    return 0;
+
+  strcpy (tmp, s);
+  while ((int) tip . size () < max_len)
+    {
+      tip . push_back (Lookup (tmp));
+      if (tip_max < tip . back () -> freq)
+        tip_max = tip . back () -> freq;
+
+      if (Successors (tmp, ch) != 1)
+        return 0;
+      memmove (tmp, tmp + 1, kmer_len - 1);
+      tmp [kmer_len - 1] = ch [0];
+
+      n = Predecessors (tmp, ch, freq);
+      if (1 < n)
+        {
+          // tmp is the join; compare with its strongest predecessor,
+          // which will include the end of the tip itself
+          other_max = 0;
+          for (i = 0; i < n; i ++)
+            if (other_max < freq [i])
+              other_max = freq [i];
+          if (tip_max < freq_ratio * other_max)
+            {
+              n = tip . size ();
+              for (i = 0; i < n; i ++)
+                tip [i] -> removed = 1;
+              return n;
+            }
+          return 0;
+        }
+    }
+
+  return 0;
+}
+
+
+#endif
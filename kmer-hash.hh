@@ -11,6 +11,7 @@
 #define  __KMER_HASH_HH_INCLUDED
 
 #include  "delcher.hh"
+#include  "seq-encode.hh"
 
 
 const int  DEFAULT_PREFIX_LEN = 10;
@@ -26,6 +27,32 @@ struct Binary_Mer_t
   __uint128_t  suffix;
 };
 
+
+extern const unsigned char  CHAR_TO_BITS [256];
+
+
+inline bool  Binary_Less
+  (const Binary_Mer_t & a, const Binary_Mer_t & b)
+
+// Return true iff kmer a comes before kmer b alphabetically, the same
+// order strcmp gives for their strings
+
+{
+  return  a . prefix < b . prefix
+            || (a . prefix == b . prefix && a . suffix < b . suffix);
+}
+
+
+inline unsigned  Char_To_Bits
+  (char ch)
+
+// Return a 2-bit equivalent of DNA base ch
+
+{
+  return  CHAR_TO_BITS [(unsigned char) ch];
+}
+
+
 template <class DT> struct Kmer_Hdr_t
 {
   vector <__uint128_t>  suffix;
@@ -57,7 +84,10 @@ public:
   void  Dump_Kmers
     (FILE * fp);
   void  Dump_Kmers_Select
-    (FILE * fp, void (* select) (FILE * p, const char * s, const DT &));
+    (FILE * fp, void (* select) (FILE * p, const char * s, const DT &),
+     bool uppercase = false);
+  DT *  Entry
+    (unsigned prefix, int j, Binary_Mer_t & bin);
   DT *  Find
     (const char * kmer);
   DT *  Find
@@ -69,7 +99,12 @@ public:
   void  Find_Or_Insert
     (const Binary_Mer_t bin, const DT & info);
   void  Fwd_Shift_In
-    (Binary_Mer_t & bin, char ch);
+    (Binary_Mer_t & bin, char ch)
+  {
+    Fwd_Shift_In_Bits (bin, Char_To_Bits (ch));
+  }
+  void  Fwd_Shift_In_Bits
+    (Binary_Mer_t & bin, unsigned a);
   void  Insert
     (const char * kmer, const DT & info);
   void  Insert
@@ -81,19 +116,38 @@ public:
   {
     Kmer_To_Binary (kmer, bin . prefix, bin . suffix);
   }
+  unsigned  Num_Prefixes
+    (void)
+  {
+    return  1u << (2 * prefix_len);
+  }
+  void  Packed_To_Binary
+    (const Packed_Seq_t & seq, size_t pos, Binary_Mer_t & fwd,
+     Binary_Mer_t & rev);
   void  Rev_Shift_In
-    (Binary_Mer_t & bin, char ch);
+    (Binary_Mer_t & bin, char ch)
+  {
+    Rev_Shift_In_Bits (bin, Char_To_Bits (ch));
+  }
+  void  Rev_Shift_In_Bits
+    (Binary_Mer_t & bin, unsigned a);
+  void  Set_First_Bits
+    (Binary_Mer_t & bin, unsigned a);
   void  Set_First_Ch
-    (Binary_Mer_t & bin, char ch);
+    (Binary_Mer_t & bin, char ch)
+  {
+    Set_First_Bits (bin, Char_To_Bits (ch));
+  }
+  void  Set_Last_Bits
+    (Binary_Mer_t & bin, unsigned a);
   void  Set_Last_Ch
-    (Binary_Mer_t & bin, char ch);
+    (Binary_Mer_t & bin, char ch)
+  {
+    Set_Last_Bits (bin, Char_To_Bits (ch));
+  }
 };
 
 
-unsigned  Char_To_Bits
-  (char ch);
-
-
 template <class DT> Kmer_Hash_t <DT> :: Kmer_Hash_t
   (int k, int p)
 
@@ -267,11 +321,13 @@ template <class DT> void  Kmer_Hash_t <DT> :: Dump_Kmers
 
 
 template <class DT> void  Kmer_Hash_t <DT> :: Dump_Kmers_Select
-  (FILE * fp, void (* select) (FILE * p, const char * s, const DT &))
+  (FILE * fp, void (* select) (FILE * p, const char * s, const DT &),
+   bool uppercase)
 
 // Run function select on all kmers in this hash, passing fp as the
 // FILE * parameter of select.  Presumably, select chooses which kmers
-// to print something about and what to print
+// to print something about and what to print.  Kmers are passed in
+// uppercase if uppercase is true.
 
 {
   Binary_Mer_t  bin;
@@ -289,7 +345,7 @@ template <class DT> void  Kmer_Hash_t <DT> :: Dump_Kmers_Select
       for (j = 0; j < m; j ++)
         {
           bin . suffix = hdr_list [i] . suffix [j];
-          Binary_To_Kmer (bin, s);
+          Binary_To_Kmer (bin, s, uppercase);
           (* select) (fp, s, hdr_list [i] . info [j]);
         }
     }
@@ -298,6 +354,25 @@ template <class DT> void  Kmer_Hash_t <DT> :: Dump_Kmers_Select
 }
 
 
+template <class DT> DT *  Kmer_Hash_t <DT> :: Entry
+  (unsigned prefix, int j, Binary_Mer_t & bin)
+
+// Set bin to the j-th kmer with binary prefix prefix in this hash and
+// return a pointer to its info.  Return NULL if there are no more than
+// j kmers with that prefix.  Visiting j = 0, 1, ... for each prefix
+// below Num_Prefixes () visits every kmer in the hash.
+
+{
+  if (int (hdr_list [prefix] . suffix . size ()) <= j)
+    return NULL;
+
+  bin . prefix = prefix;
+  bin . suffix = hdr_list [prefix] . suffix [j];
+
+  return & (hdr_list [prefix] . info [j]);
+}
+
+
 template <class DT> DT *  Kmer_Hash_t <DT> :: Find
   (const char * kmer)
 
@@ -410,25 +485,25 @@ template <class DT> void  Kmer_Hash_t <DT> :: Find_Or_Insert
 }
 
 
-template <class DT> void  Kmer_Hash_t <DT> :: Fwd_Shift_In
-  (Binary_Mer_t & bin, char ch)
+template <class DT> void  Kmer_Hash_t <DT> :: Fwd_Shift_In_Bits
+  (Binary_Mer_t & bin, unsigned a)
 
 // Remove the front (first) character from the kmer in bin;
 // shift the other characters one position (2 bits) left;
-// then add ch onto the end
+// then add the character with 2-bit code a onto the end
 
 {
-  __uint128_t  a;
+  __uint128_t  b;
 
   bin . prefix &= ~ prefix_first_mask;
   bin . prefix <<= 2;
-  a = bin . suffix & suffix_first_mask;
-  a >>= (2 * (suffix_len - 1));
-  bin . prefix |= unsigned (a);
+  b = bin . suffix & suffix_first_mask;
+  b >>= (2 * (suffix_len - 1));
+  bin . prefix |= unsigned (b);
 
   bin . suffix &= ~ suffix_first_mask;
   bin . suffix <<= 2;
-  bin . suffix |= __uint128_t (Char_To_Bits (ch));
+  bin . suffix |= __uint128_t (a);
 }
 
 
@@ -441,7 +516,7 @@ template <class DT> void  Kmer_Hash_t <DT> :: Insert
 {
   __uint128_t  suff;
   unsigned  pref;
-  printf("*****Printing strlen %d and kmer length %d",strlen(kmer), kmer_len);
+
   assert (int (strlen (kmer)) == kmer_len);
   Kmer_To_Binary (kmer, pref, suff);
 
@@ -490,55 +565,78 @@ template <class DT> void  Kmer_Hash_t <DT> :: Kmer_To_Binary
 }
 
 
-template <class DT> void  Kmer_Hash_t <DT> :: Rev_Shift_In
-  (Binary_Mer_t & bin, char ch)
+template <class DT> void  Kmer_Hash_t <DT> :: Packed_To_Binary
+  (const Packed_Seq_t & seq, size_t pos, Binary_Mer_t & fwd,
+   Binary_Mer_t & rev)
+
+// Set fwd to the kmer starting at position pos of the packed sequence
+// seq and rev to its reverse complement.  Following kmers can then be
+// made by shifting in one base at a time with Fwd_Shift_In_Bits and
+// Rev_Shift_In_Bits.
+
+{
+  unsigned  a;
+  int  i;
+
+  fwd . prefix = rev . prefix = 0;
+  fwd . suffix = rev . suffix = 0;
+
+  for (i = 0; i < prefix_len; i ++)
+    {
+      fwd . prefix = (fwd . prefix << 2) | seq . Base (pos + i);
+      a = 3 - seq . Base (pos + kmer_len - 1 - i);
+      rev . prefix = (rev . prefix << 2) | a;
+    }
+
+  for ( ; i < kmer_len; i ++)
+    {
+      fwd . suffix = (fwd . suffix << 2) | seq . Base (pos + i);
+      a = 3 - seq . Base (pos + kmer_len - 1 - i);
+      rev . suffix = (rev . suffix << 2) | a;
+    }
+}
+
+
+template <class DT> void  Kmer_Hash_t <DT> :: Rev_Shift_In_Bits
+  (Binary_Mer_t & bin, unsigned a)
 
 // Remove the tail (last) character from the kmer in bin;
 // shift the other characters one position (2 bits) right;
-// then add ch onto the front
+// then add the character with 2-bit code a onto the front
 
 {
-  unsigned  a;
   __uint128_t  b;
 
-  a = 3u & bin . prefix;
-  b = __uint128_t (a);
+  b = __uint128_t (3u & bin . prefix);
   bin . suffix >>= 2;
   bin . suffix |= (b << 2 * (suffix_len - 1));
 
   bin . prefix >>= 2;
-  a = Char_To_Bits (ch);
   bin . prefix |= (a << 2 * (prefix_len - 1));
 }
 
 
-template <class DT> void  Kmer_Hash_t <DT> :: Set_First_Ch
-  (Binary_Mer_t & bin, char ch)
+template <class DT> void  Kmer_Hash_t <DT> :: Set_First_Bits
+  (Binary_Mer_t & bin, unsigned a)
 
-// Change the first (front) character of the kmer in bin to ch
+// Change the first (front) character of the kmer in bin to the one
+// with 2-bit code a
 
 {
-  unsigned  a;
-
-  a = Char_To_Bits (ch);
-
   bin . prefix &= (~ prefix_first_mask);
   bin . prefix |= (a << 2 * (prefix_len - 1));
 }
 
 
-template <class DT> void  Kmer_Hash_t <DT> :: Set_Last_Ch
-  (Binary_Mer_t & bin, char ch)
+template <class DT> void  Kmer_Hash_t <DT> :: Set_Last_Bits
+  (Binary_Mer_t & bin, unsigned a)
 
-// Change the last (tail) character of the kmer in bin to ch
+// Change the last (tail) character of the kmer in bin to the one
+// with 2-bit code a
 
 {
-  __uint128_t  a;
-
-  a = Char_To_Bits (ch);
-
   bin . suffix &= (~ suffix_last_mask);
-  bin . suffix |= a;
+  bin . suffix |= __uint128_t (a);
 }
 
 
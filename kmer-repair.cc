@@ -24,45 +24,98 @@ extern int  Global_Debug_Flag;
 
 // Global variables
 
+bool  Fastq_Mode = false;
+  // If true, read and write fastq records instead of fasta sequences,
+  // set by -q option or when the sequence file is detected to be fastq
+thread_local Search_Budget_t  Gap_Budget;
+  // Nodes expanded and time used by the current gap or extension search
+  // in this thread
 int  Hash_Prefix_Chars = DEFAULT_HASH_PREFIX_CHARS;
   // Prefix length of kmers directly indexed in array
+const char  * Cleaned_Kmer_Filename = NULL;
+  // Name of file to which to write the kmer counts left after cleaning,
+  // set by -W option
+const char  * Correction_Filename = NULL;
+  // Name of file to which to write one tab-separated record per
+  // correction, set by -c option.  Also turns off the per-kmer trace
+  // on stdout unless -V is given.
 const char  * Kmer_Count_Filename;
   // Name of file from which to read kmer counts
 int  Kmer_Len = -1;
   // Length of kmers
+int  Max_Bubble_Len = 0;
+  // Pop bubbles with weak branches of at most this many kmers before
+  // repairing, set by -P option.  Zero means don't.
+long unsigned  Max_Expansions = 0;
+  // Most kmer nodes a single gap or extension search may expand before
+  // it is abandoned, set by -e option.  Zero means no limit.
 int  Max_Gap = DEFAULT_MAX_GAP;
   // Longest gap that will attempt to correct
+int  Min_Anchor_Qual = 0;
+  // In fastq mode, kmers containing a base with phred quality below this
+  // are not used as anchors for gaps or extensions, set by -Q option
 unsigned  Max_Paths = DEFAULT_MAX_PATHS;
   // Maximum number of sequences that can be used for extension or
   // correction.  If more than this many sequences are found, no correction
   // is attempted.
+unsigned  Max_Passes = 1;
+  // Most repair passes to make over each sequence, set by -p option.
+  // Zero means repeat until a pass makes no corrections.
+double  Max_Search_Seconds = 0.0;
+  // Most wall-clock seconds a single gap or extension search may take
+  // before it is abandoned, set by -w option.  Zero means no limit.
+int  Max_Tip_Len = 0;
+  // Clip weak tips of at most this many kmers before repairing, set
+  // by -T option.  Zero means don't.
+int  Num_Threads = 1;
+  // Number of worker threads repairing reads, set by -t option
+bool  Print_Trace = true;
+  // If true, print the per-kmer match trace and search log to stdout
+  // along with the corrected sequences.  Verbose output from the
+  // repair routines is also printed only if this is set.
 const char  * Sequence_Filename;
   // Name of file with DNA fasta sequences
+int  Read_Batch = DEFAULT_READ_BATCH;
+  // Most records read but not yet written at once, set by -b option.
+  // Bounds the memory used for reads.
+const char  * Stats_Filename = NULL;
+  // Name of file to which to write per-sequence search statistics,
+  // set by -s option
 
 
 int  main
   (int argc, char * argv [])
 
 {
-  FILE  * sequence_fp, * kmer_count_fp;
+  FILE  * sequence_fp, * kmer_count_fp, * stats_fp = NULL, * correct_fp = NULL;
   Kmer_Hash_t <Kmer_Info_t>  * kmer_hash;
-  string  seq_string, seq_hdr;
+  Repair_Stats_t  total_stats;
+  Seq_Reader_t  * seq_reader;
   Kmer_Info_t  info;
-  char  fmer [MAX_LINE], rmer [MAX_LINE], last_fmer [MAX_LINE];
   char  s [MAX_LINE];
-  const char  * seq;
   unsigned  max_count;
-  int  ct, seq_len, max_extend;
-  int  i, j, n;
+  int  ct;
+  int  i;
 
   Verbose = 0;
 
   Parse_Command_Line (argc, argv);
 
+  Fasta_Buffer_Output (stdout);
+
   if (strcmp (Sequence_Filename, "-") == 0)
     sequence_fp = stdin;
   else
     sequence_fp = File_Open (Sequence_Filename, "r");
+  seq_reader = new Seq_Reader_t (sequence_fp);
+  if (seq_reader -> Is_Fastq ())
+    Fastq_Mode = true;
+  else if (Fastq_Mode)
+    {
+      sprintf (Clean_Exit_Msg_Line,
+               "ERROR:  Sequence file %s is not fastq", Sequence_Filename);
+      Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+    }
 
   if (strcmp (Kmer_Count_Filename, "-") == 0)
     {
@@ -77,8 +130,29 @@ int  main
   else
     kmer_count_fp = File_Open (Kmer_Count_Filename, "r");
 
+  if (Stats_Filename != NULL)
+    {
+      stats_fp = File_Open (Stats_Filename, "w");
+      fprintf (stats_fp, "#%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n", "id", "len",
+               "passes", "searches", "exhausted", "expansions", "corrections",
+               "seconds");
+    }
+
+  if (Correction_Filename != NULL)
+    {
+      correct_fp = File_Open (Correction_Filename, "w");
+      fprintf (correct_fp, "#%s\t%s\t%s\t%s\t%s\t%s\n", "id", "pass", "lo", "hi",
+               "type", "replacement");
+      Print_Trace = (0 < Verbose);
+    }
+  if (Fastq_Mode)
+    Print_Trace = (0 < Verbose && Num_Threads == 1);
+  else if (1 < Num_Threads)
+    Print_Trace = false;
+
   max_count = (1 << KMER_INFO_FREQ_BITS) - 1;
-  printf ("max_count = %d\n", max_count);
+  if (Print_Trace)
+    printf ("max_count = %d\n", max_count);
 
   fprintf (stderr, "Reading kmer counts ...\n");
   i = 0;
@@ -96,8 +170,6 @@ int  main
       else
         info . freq = ct;
 
-      for (j = 0; j < Kmer_Len; j ++)
-        s [j] = toupper (s [j]);
       kmer_hash -> Insert (s, info);
 
       i ++;
@@ -113,323 +185,168 @@ int  main
 #endif
     }
   fprintf (stderr, "Total counts read = %d\n", i);
+  if (0 < Verbose)
+    fprintf (stderr, "Sequence encoding kernel:  %s\n", Encode_Seq_Kernel ());
 
   if (kmer_count_fp != stdin)
     fclose (kmer_count_fp);
 
-  // Read and process the fasta sequences
-  while (Fasta_Read (sequence_fp, seq_string, seq_hdr))
+  if (0 < Max_Tip_Len || 0 < Max_Bubble_Len)
     {
-      vector <string>  path;
-      vector <Correction_t>  correct;
-      Correction_t  corr;
-      Kmer_Info_t  * p;
-      double  erate;
-      int  dist, last_match;
-
-      seq_len = seq_string . length ();
-      if (seq_len < Kmer_Len)
-        {
-          fprintf (stderr,
-                   "Skipping sequence %s with length %d shorter than kmer length %d\n",
-                   seq_hdr . c_str (), seq_len, Kmer_Len);
-          continue;
-        }
+      Kmer_Cleaner_t <Kmer_Info_t>  cleaner (kmer_hash, Kmer_Len);
+      long unsigned  tip_mers, bubble_mers;
 
-      for (i = 0; i < seq_len; i ++)
-        seq_string [i] = toupper (seq_string [i]);
-      seq = seq_string . c_str ();
+      fprintf (stderr, "Cleaning kmer graph ...\n");
+      cleaner . Clean (Max_Tip_Len, Max_Bubble_Len, tip_mers, bubble_mers);
+      fprintf (stderr, "Removed %s tip kmers", Commatize (tip_mers));
+      fprintf (stderr, " and %s bubble kmers\n", Commatize (bubble_mers));
+    }
+  if (Cleaned_Kmer_Filename != NULL)
+    {
+      FILE  * fp = File_Open (Cleaned_Kmer_Filename, "w");
 
-      printf ("\n#%s  len=%d\n", seq_hdr . c_str (), seq_len);
+      kmer_hash -> Dump_Kmers_Select (fp, & Print_If_Kept <Kmer_Info_t>, true);
+      fclose (fp);
+    }
 
-      strncpy (fmer, seq, Kmer_Len);
-      fmer [Kmer_Len] = '\0';
-      strcpy (rmer, fmer);
-      Reverse_Complement (rmer);
-      
-      last_match = -1;
-      for (i = 1; i <= seq_len - Kmer_Len + 1; i ++)
-        {
-          char  tag [MAX_LINE];
+  Repair_Reads (seq_reader, kmer_hash, correct_fp, stats_fp, total_stats);
 
-          // Don't allow matches to N's.  They can happen because N's
-          // are converted to A's in the kmer hash.
-          if (strchr (fmer, 'N') == NULL)
-            p = Find_Mer (kmer_hash, fmer, rmer);
-          else
-            p = NULL;
+  delete seq_reader;
+  if (sequence_fp != stdin)
+    fclose (sequence_fp);
+  if (stats_fp != NULL)
+    fclose (stats_fp);
+  if (correct_fp != NULL)
+    fclose (correct_fp);
 
-          if (p == NULL)
-            ct = 0;
-          else
-            ct = p -> freq;
+  fprintf (stderr, "Searches abandoned for budget:  %d of %d  (%s node expansions)\n",
+           total_stats . exhausted, total_stats . searches,
+           Commatize (total_stats . expansions));
 
-          if (p == NULL)
-            sprintf (tag, "unmatched");
-          else
-            sprintf (tag, "ct= %d", ct);
-          printf ("%5d  %s  %s\n", i, fmer, tag);
+  return  0;
+}
 
-          if (p != NULL)
-            {
-              if (last_match == -1)
-                { // this is the first match and there are prior unmatched kmers
-                  // see if there are extensions left from it that can be used
-                  // to repair the sequence
-                  if (1 < i)
-                    {
-                      max_extend = int (1.1 * (i - 1) + 10);
-                        // have i-1 unmatched kmers; allow extra characters
-                        // in extension in case of indels
-                      
-                      Get_Left_Extensions (fmer, rmer, path, kmer_hash, max_extend);
-                      n = path . size ();
-                    }
-                  else
-                    n = 0;
 
-                  if (Max_Paths < unsigned (n))
-                    {
-                      printf ("  Found more than %d extensions--ignoring\n", Max_Paths);
-                      path . clear ();
-                      n = 0;
-                    }
-                  else if (1 < i)
-                    printf ("  Found %d left extensions\n", n);
+static void  Add_Stats
+  (Repair_Stats_t & total, const Repair_Stats_t & stats)
 
-                  if (0 < n)
-                    {
-                      bool  made_correction = false;
-                      int  seq_lo, path_lo;
+// Add the search and correction counts in stats to total.
 
-                      j = Choose_Best_Left_Extension (seq, i - 2, path,
-                                                      dist, seq_lo, path_lo);
-                      if (j < 0)
-                        erate = DBL_MAX;
-                      else
-                        erate = (1.0 * dist) / (path [j] . length () - path_lo);
-                      if (path_lo == 0 && erate <= MAX_EXTENSION_ERATE)
-                        {
-                          corr . lo = seq_lo;
-                          corr . hi = i - 1;
-                          corr . replacement = path [j] . substr (path_lo,
-                                                 path [j] . length () - path_lo);
-                          correct . push_back (corr);
-                          made_correction = true;
-                        }
-                      if (0 < Verbose)
-                        printf ("Best left extension is path j= %d  dist= %d"
-                                "  erate= %.2f%%\n",
-                                j, dist, 100.0 * erate);
-                      if (0 <= j && 0 < Verbose)
-                        {
-                          string  s, t;
-
-                          t = seq;
-                          s = t . substr (seq_lo, i - 1 - seq_lo);
-                          printf ("Replace:  %s\n", s . c_str ());
-                          s = path [j] . substr (path_lo,
-                                                 path [j] . length () - path_lo);
-                          printf ("   with:  %s\n", s . c_str ());
-                          if (made_correction)
-                            printf ("  Correction made\n");
-                          else
-                            printf ("  Correction NOT made\n");
-                        }
-                    }
-                }
-              else if (i != last_match + 1)
-                {
-                  int  len;
-                  int  gap = i - last_match - 1;
+{
+  total . searches += stats . searches;
+  total . exhausted += stats . exhausted;
+  total . expansions += stats . expansions;
+  total . corrections += stats . corrections;
 
-                  printf ("  Unmatched gap of length %d\n", gap);
-                  printf ("  Search paths from %s\n", last_fmer);
-                  printf ("                 to %s\n", fmer);
-                  
-                  if (gap <= Max_Gap)
-                    {
-                      // First check if a path exists so we don't waste
-                      // too much time enumerating hopeless paths
-                      // i values start at one; string positions start at zero
-//**ALD  Changed here
-                      if (Path_Exists (seq, last_match - 1, i - 1, len, kmer_hash))
-                        {
-                          Get_Paths (seq, last_match - 1, i - 1, path, kmer_hash);
-                          n = path . size ();
-                          if (Max_Paths < unsigned (n))
-                            {
-                              printf ("  Found more than %d paths--ignoring\n", Max_Paths);
-                              path . clear ();
-                              n = 0;
-                            }
-                          else
-                            printf ("  Found %d paths\n", n);
-                        }
-                      else
-                        {
-                          path . clear ();
-                          n = 0;
-                        }
+  return;
+}
 
-                      if (0 < n)
-                        {
-                          int  path_sep, read_sep;
-
-                          j = Choose_Best_Path (seq, last_match - 1, i - 1, path, dist);
-                          printf ("best path= %d  score= %d\n", j, dist);
-                          corr . lo = last_match + Kmer_Len - 1;
-                          corr . hi = i - 1;
-                          read_sep = corr . hi - corr . lo;
-                            // offset between start & end kmers on read to be corrected
-                          path_sep = path [j] . length () - 2 * Kmer_Len;
-                            // offset between those kmers on correct path
-                          if (0 <= read_sep && 0 <= path_sep)
-                            { // simple replacement
-                              corr . replacement
-                                = path [j] . substr (Kmer_Len, path_sep);
-                            }
-                          else if (read_sep < path_sep)
-                            { // read_sep is negative and need insertion
-                              corr . hi = corr . lo;
-                              corr . replacement
-                                = path [j] . substr (Kmer_Len, path_sep - read_sep);
-                            }
-                          else if (path_sep < read_sep)
-                            { // path_sep is negative and need deletion
-                              corr . hi = corr . lo + read_sep - path_sep;
-                              corr . replacement = "";
-                            }
-                          else
-                            { // this can't happen--the read & path sequences would be
-                              // the same and there wouldn't be a gap to fix
-                              fprintf (stderr, "read_sep= %d  path_sep= %d\n",
-                                       read_sep, path_sep);
-                              assert (false);
-                            }
-                          
-                          if (0 < Verbose)
-                            {
-                              char  * old;
-
-
-                              old = (char *) malloc (1 + corr . hi - corr . lo);
-                              strncpy (old, seq + corr . lo, corr . hi - corr . lo);
-                              old [corr . hi - corr . lo] = '\0';
-                              printf ("Replace pos %d..%d\n"
-                                      "     >%s<\n"
-                                      "with >%s<\n",
-                                      corr . lo, corr . hi, old,
-                                      corr . replacement . c_str ());
-                              free (old);
-                            }
-                          correct . push_back (corr);
-                        }
-                    }
-                  else
-                    printf ("  Gap too long--skipping\n");
-                }
-              last_match = i;
-              strcpy (last_fmer, fmer);
-            }
 
-          // Advance to next character
-          memmove (fmer, fmer + 1, Kmer_Len - 1);
-          memmove (rmer + 1, rmer, Kmer_Len - 1);
-          fmer [Kmer_Len - 1] = seq [i + Kmer_Len - 1];
-          rmer [0] = Complement (fmer [Kmer_Len - 1]);
-        }
+static void  Apply_Corrections
+  (string & seq_string, string * qual, const vector <Correction_t> & correct,
+   vector <int> & match_ct, vector <char> & dirty)
 
-      if (0 < last_match && last_match < seq_len - Kmer_Len + 1)
+// Replace seq_string by the result of making the corrections in correct
+// (which must be in order and non-overlapping) to it.  If qual is not
+// NULL, make the same changes to it, giving inserted bases quality
+// CORRECTED_BASE_QUAL.  Remap match_ct and dirty, which are indexed by
+// kmer start position, to the corrected string:  kmers lying entirely
+// within a stretch of seq_string that was not changed keep their count
+// and are marked clean; all others are marked dirty.
+
+{
+  string  corr_seq, corr_qual;
+  vector <int>  new_ct;
+  vector <char>  new_dirty;
+  int  hi, num_kmers, prev, seq_len, start;
+  int  i, n, q;
+
+  seq_len = seq_string . length ();
+  n = correct . size ();
+  prev = 0;
+  for (i = 0; i < n; i ++)
+    {
+      corr_seq . append (seq_string, prev, correct [i] . lo - prev);
+      corr_seq . append (correct [i] . replacement);
+      prev = correct [i] . hi;
+    }
+  if (prev < seq_len)
+    corr_seq . append (seq_string, prev, seq_len - prev);
+
+  if (qual != NULL)
+    {
+      prev = 0;
+      for (i = 0; i < n; i ++)
         {
-          j = seq_len - Kmer_Len + 1 - last_match;
-          max_extend = int (1.1 * j + 10);
-            // have j unmatched kmers; allow extra characters
-            // in extension in case of indels
+          corr_qual . append (* qual, prev, correct [i] . lo - prev);
+          corr_qual . append (correct [i] . replacement . length (),
+                              char (FASTQ_QUALITY_OFFSET + CORRECTED_BASE_QUAL));
+          prev = correct [i] . hi;
+        }
+      if (prev < seq_len)
+        corr_qual . append (* qual, prev, seq_len - prev);
+      qual -> swap (corr_qual);
+    }
 
-          printf ("Try right extension  last_match= %d  seq_len= %d  max_extend= %d\n",
-                  last_match, seq_len, max_extend);
+  num_kmers = int (corr_seq . length ()) - Kmer_Len + 1;
+  if (num_kmers < 0)
+    num_kmers = 0;
+  new_ct . assign (num_kmers, -1);
+  new_dirty . assign (num_kmers, 1);
 
-          Get_Right_Extensions (seq, last_match - 1, seq_len, path, kmer_hash,
-                                max_extend);
+  // start is the position in corr_seq of the unchanged stretch
+  // seq_string [prev .. (hi - 1)]
+  prev = start = 0;
+  for (i = 0; i <= n; i ++)
+    {
+      hi = (i < n ? correct [i] . lo : seq_len);
+      for (q = prev; q + Kmer_Len <= hi; q ++)
+        {
+          new_ct [start + q - prev] = match_ct [q];
+          new_dirty [start + q - prev] = 0;
+        }
+      if (i < n)
+        {
+          start += hi - prev + correct [i] . replacement . length ();
+          prev = correct [i] . hi;
+        }
+    }
 
-          n = path . size ();
-          if (Max_Paths < unsigned (n))
-            {
-              printf ("  Found more than %d extensions--ignoring\n", Max_Paths);
-              path . clear ();
-              n = 0;
-            }
-          else
-            printf ("  Found %d right extensions\n", n);
+  seq_string = corr_seq;
+  match_ct . swap (new_ct);
+  dirty . swap (new_dirty);
 
-          if (0 < n)
-            {
-              bool  made_correction = false;
-              int  seq_hi, path_hi;
+  return;
+}
 
-              j = Choose_Best_Right_Extension (seq + last_match + Kmer_Len - 1,
-                                               path, dist, seq_hi, path_hi);
 
-              printf ("j= %d\n", j);
-              if (j < 0)
-                erate = DBL_MAX;
-              else
-                erate = (2.0 * dist) / (seq_hi + path_hi);
-              if (erate <= MAX_EXTENSION_ERATE)
-                {
-                  corr . lo = last_match + Kmer_Len - 1;
-                  corr . hi = corr . lo + seq_hi;
-                  corr . replacement = path [j] . substr (0, path_hi);
-                  correct . push_back (corr);
-                  made_correction = true;
-                }
-              if (0 < j && 0 < Verbose)
-                {
-                  string  s, t;
-
-                  printf ("Best right extension is path j= %d  dist= %d"
-                          "  erate= %.2f%%\n",
-                          j, dist, 100.0 * erate);
-                  t = seq;
-                  s = t . substr (last_match + Kmer_Len - 1, seq_hi);
-                  printf ("Replace:  %s\n", s . c_str ());
-                  s = path [j] . substr (0, path_hi);
-                  printf ("   with:  %s\n", corr . replacement . c_str ());
-                  if (made_correction)
-                    printf ("  Correction made\n");
-                  else
-                    printf ("  Correction NOT made\n");
-                }
-            }
-        }
+static bool  Charge_Budget
+  (void)
 
-      if (0 < Verbose)
-        printf ("Number of correction segments is %lu\n", correct . size ());
+// Count one more kmer node expansion against the current search
+// budget in global Gap_Budget.  Return true if the search may continue;
+// otherwise, mark the budget exhausted and return false.  The wall clock
+// is only consulted every BUDGET_CLOCK_INTERVAL expansions.
 
-      // Output corrected sequence
-      string  corr_seq;
-      int  prev;
+{
+  if (Gap_Budget . exhausted)
+    return false;
 
-      n = correct . size ();
-      prev = 0;
-      for (i = 0; i < n; i ++)
-        {
-          corr_seq . append (seq_string . substr (prev, correct [i] . lo - prev));
-          corr_seq . append (correct [i] . replacement);
-          prev = correct [i] . hi;
-        }
-      if (prev < seq_len)
-        corr_seq . append (seq_string . substr (prev, seq_len - prev));
-      if (0 < n)
-        seq_hdr . append ("  corrected");
-      Fasta_Print (stdout, corr_seq . c_str (), seq_hdr . c_str ());
+  if (0 < Max_Expansions && Max_Expansions <= Gap_Budget . expansions)
+    {
+      Gap_Budget . exhausted = 'n';
+      return false;
+    }
+  Gap_Budget . expansions ++;
+  if (0.0 < Max_Search_Seconds
+        && Gap_Budget . expansions % BUDGET_CLOCK_INTERVAL == 0
+        && Max_Search_Seconds < Wall_Time () - Gap_Budget . start_time)
+    {
+      Gap_Budget . exhausted = 't';
+      return false;
     }
 
-  if (sequence_fp != stdin)
-    fclose (sequence_fp);
-
-  return  0;
+  return true;
 }
 
 
@@ -449,7 +366,7 @@ static int  Choose_Best_Left_Extension
   int  s_lo, p_lo;
   int  d, i, n;
 
-  if (0 < Verbose)
+  if (Print_Trace && 0 < Verbose)
     printf ("Choose_Best_Left_Extension:\n");
   dist = INT_MAX;  // impossibly high value
   best_erate = 2.0;  // impossibly high
@@ -462,7 +379,7 @@ static int  Choose_Best_Left_Extension
         erate = (2.0 * d) / (1 + hi - s_lo + path [i] . length () - p_lo);
       else
         erate = 2.0;
-      if (0 < Verbose)
+      if (Print_Trace && 0 < Verbose)
         {
           printf ("path= %d  d= %d  erate= %6.4f\n", i, d, erate);
           printf ("  hi= %d  s_lo= %d  p_lo= %d\n", hi, s_lo, p_lo);
@@ -494,12 +411,12 @@ static int  Choose_Best_Path
   int  best = -1, len;
   int  d, i, n;
 
-  if (0 < Verbose)
+  if (Print_Trace && 0 < Verbose)
     printf ("Choose_Best_Path:\n");
   dist = len = to + Kmer_Len - from;
   ref = (char *) malloc (len + 1);
 
-  if (0 < Verbose)
+  if (Print_Trace && 0 < Verbose)
     printf ("from= %d  to= %d  len= %d  seq_len= %lu\n", from, to, len, strlen (seq));
   strncpy (ref, seq + from, len);
   ref [len] = '\0';
@@ -508,7 +425,7 @@ static int  Choose_Best_Path
   for (i = 0; i < n; i ++)
     {
       d = Edit_Dist (ref, path [i] . c_str ());
-      if (0 < Verbose)
+      if (Print_Trace && 0 < Verbose)
         printf ("path= %d  d= %d\n", i, d);
       if (d < dist)
         {
@@ -549,7 +466,7 @@ static int  Choose_Best_Right_Extension
   int  s_hi, p_hi, path_len, seq_len;
   int  d, i, n;
 
-  if (0 < Verbose)
+  if (Print_Trace && 0 < Verbose)
     printf ("Choose_Best_Right_Extension:\n");
   dist = INT_MAX;  // impossibly high value
   best_erate = 2.0;  // impossibly high
@@ -564,7 +481,7 @@ static int  Choose_Best_Right_Extension
         erate = (2.0 * d) / (s_hi + p_hi);
       else
         erate = 2.0;
-      if (0 < Verbose)
+      if (Print_Trace && 0 < Verbose)
         {
           printf ("path= %d  d= %d  erate= %6.4f\n", i, d, erate);
           printf ("  seq_len= %d  path_len= %d  s_hi= %d  p_hi= %d\n",
@@ -592,12 +509,12 @@ static int  Edit_Dist
 // Vishkin-Schieber algorithm
 
 {
-  static short int  * space = NULL;
-  static int  save_sz = -1;
+  static thread_local short int  * space = NULL;
+  static thread_local int  save_sz = -1;
   int  from, max_errs, sz;
   int  d, e, i, j, m, n;
 
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     printf ("Edit_Dist:\n");
   m = strlen (a);
   n = strlen (b);
@@ -611,7 +528,7 @@ static int  Edit_Dist
       save_sz = sz;
     }
 
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     {
       printf ("m= %d  n= %d  max_errs= %d  sz= %d\n", m, n, max_errs, sz);
       Fasta_Print (stdout, a, "a-string");
@@ -628,7 +545,7 @@ static int  Edit_Dist
   if (i == m && i == n)
     return  0;  // strings are identical
 
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     printf ("e= %d  d= %d  S= %d\n", 0, 0, S (0, 0));
   for (e = 1; e <= max_errs; e ++)
     for (d = -e; d <= e; d ++)
@@ -654,7 +571,7 @@ static int  Edit_Dist
         S (e, d) = i;
         if (i == m && i + d == n)
           return e;
-        if (1 < Verbose)
+        if (Print_Trace && 1 < Verbose)
           printf ("e= %d  d= %d  from= %d  S= %d  sub= %d\n",
                   e, d, from, S (e, d), e * (e + 1) + d);
       }
@@ -663,6 +580,368 @@ static int  Edit_Dist
 }
 
 
+static void  Find_Corrections
+  (const string & seq_string, Kmer_Hash_t <Kmer_Info_t> * kmer_hash,
+   vector <int> & match_ct, const vector <char> & dirty,
+   vector <Correction_t> & correct, Repair_Stats_t & stats)
+
+// Look up the kmers of seq_string in kmer_hash and put into correct the
+// corrections of unmatched regions found from paths of kmers between
+// and off the ends of the matches.  match_ct [i] is the count of the kmer
+// starting at position i of seq_string, or -1 if it has no match.
+// Entries for which dirty [i] is false are presumed still valid from a
+// previous pass and are not looked up again; gaps and extensions that
+// have no dirty kmer are not searched again.  Add search counts to stats.
+
+{
+  vector <string>  path;
+  vector <int>  dirty_ct;
+  Correction_t  corr;
+  Kmer_Info_t  * p;
+  Packed_Seq_t  packed;
+  Binary_Mer_t  fbin, rbin;
+  char  fmer [MAX_LINE], rmer [MAX_LINE];
+  const char  * seq;
+  double  erate;
+  int  ct, dist, last_match, max_extend, num_kmers, seq_len;
+  int  i, j, n;
+
+  correct . clear ();
+
+  seq = seq_string . c_str ();
+  seq_len = seq_string . length ();
+  num_kmers = seq_len - Kmer_Len + 1;
+
+  // dirty_ct [i] is the number of dirty kmers before kmer i (counting
+  // from 1), so kmers a .. b include a dirty one iff
+  // dirty_ct [a - 1] < dirty_ct [b]
+  dirty_ct . resize (num_kmers + 1);
+  dirty_ct [0] = 0;
+  for (i = 0; i < num_kmers; i ++)
+    dirty_ct [i + 1] = dirty_ct [i] + (dirty [i] ? 1 : 0);
+
+  // Kmers are made from the 2-bit codes of the sequence, shifting in
+  // one base at a time on both strands
+  Encode_Seq (seq, seq_len, packed);
+  kmer_hash -> Packed_To_Binary (packed, 0, fbin, rbin);
+
+  last_match = -1;
+  for (i = 1; i <= num_kmers; i ++)
+    {
+      char  tag [MAX_LINE];
+
+      // Kmers unchanged since the previous pass keep their count.
+      // Don't allow matches to N's or other non-ACGT characters.
+      // They can happen because they're converted to A's in the kmer hash.
+      if (dirty [i - 1])
+        {
+          if (packed . Has_Bad (i - 1, i - 1 + Kmer_Len))
+            p = NULL;
+          else
+            p = Find_Mer (kmer_hash, fbin, rbin);
+          match_ct [i - 1] = (p == NULL ? -1 : int (p -> freq));
+        }
+      ct = match_ct [i - 1];
+
+      if (Print_Trace)
+        {
+          if (ct < 0)
+            sprintf (tag, "unmatched");
+          else
+            sprintf (tag, "ct= %d", ct);
+          printf ("%5d  %.*s  %s\n", i, Kmer_Len, seq + i - 1, tag);
+        }
+
+      if (0 <= ct)
+        {
+          if (last_match == -1)
+            { // this is the first match and there are prior unmatched kmers
+              // see if there are extensions left from it that can be used
+              // to repair the sequence
+              bool  exhausted = false, search;
+
+              search = (1 < i && 0 < dirty_ct [i]);
+              if (search)
+                {
+                  max_extend = int (1.1 * (i - 1) + 10);
+                    // have i-1 unmatched kmers; allow extra characters
+                    // in extension in case of indels
+                  
+                  strncpy (fmer, seq + i - 1, Kmer_Len);
+                  fmer [Kmer_Len] = '\0';
+                  strcpy (rmer, fmer);
+                  Reverse_Complement (rmer);
+                  Start_Budget ();
+                  Get_Left_Extensions (fmer, rmer, path, kmer_hash, max_extend);
+                  n = path . size ();
+                  exhausted = Report_Budget (stats);
+                }
+              else
+                n = 0;
+
+              if (exhausted)
+                {
+                  path . clear ();
+                  n = 0;
+                }
+              else if (Max_Paths < unsigned (n))
+                {
+                  if (Print_Trace)
+                    printf ("  Found more than %d extensions--ignoring\n", Max_Paths);
+                  path . clear ();
+                  n = 0;
+                }
+              else if (search && Print_Trace)
+                printf ("  Found %d left extensions\n", n);
+
+              if (0 < n)
+                {
+                  bool  made_correction = false;
+                  int  seq_lo, path_lo;
+
+                  j = Choose_Best_Left_Extension (seq, i - 2, path,
+                                                  dist, seq_lo, path_lo);
+                  if (j < 0)
+                    erate = DBL_MAX;
+                  else
+                    erate = (1.0 * dist) / (path [j] . length () - path_lo);
+                  if (path_lo == 0 && erate <= MAX_EXTENSION_ERATE)
+                    {
+                      corr . lo = seq_lo;
+                      corr . hi = i - 1;
+                      corr . kind = 'L';
+                      corr . replacement = path [j] . substr (path_lo,
+                                             path [j] . length () - path_lo);
+                      correct . push_back (corr);
+                      made_correction = true;
+                    }
+                  if (Print_Trace && 0 < Verbose)
+                    printf ("Best left extension is path j= %d  dist= %d"
+                            "  erate= %.2f%%\n",
+                            j, dist, 100.0 * erate);
+                  if (0 <= j && Print_Trace && 0 < Verbose)
+                    {
+                      string  s, t;
+
+                      t = seq;
+                      s = t . substr (seq_lo, i - 1 - seq_lo);
+                      printf ("Replace:  %s\n", s . c_str ());
+                      s = path [j] . substr (path_lo,
+                                             path [j] . length () - path_lo);
+                      printf ("   with:  %s\n", s . c_str ());
+                      if (made_correction)
+                        printf ("  Correction made\n");
+                      else
+                        printf ("  Correction NOT made\n");
+                    }
+                }
+            }
+          else if (i != last_match + 1)
+            {
+              int  len;
+              int  gap = i - last_match - 1;
+
+              if (Print_Trace)
+                {
+                  printf ("  Unmatched gap of length %d\n", gap);
+                  printf ("  Search paths from %.*s\n", Kmer_Len,
+                          seq + last_match - 1);
+                  printf ("                 to %.*s\n", Kmer_Len, seq + i - 1);
+                }
+              
+              if (dirty_ct [i] == dirty_ct [last_match - 1])
+                {
+                  if (Print_Trace)
+                    printf ("  Unchanged since previous pass--skipping\n");
+                }
+              else if (gap <= Max_Gap)
+                {
+                  // First check if a path exists so we don't waste
+                  // too much time enumerating hopeless paths
+                  // i values start at one; string positions start at zero
+                  // Both searches share one budget for this gap
+//**ALD  Changed here
+                  Start_Budget ();
+                  if (Path_Exists (seq, last_match - 1, i - 1, len, kmer_hash))
+                    {
+                      Get_Paths (seq, last_match - 1, i - 1, path, kmer_hash);
+                      n = path . size ();
+                      if (Report_Budget (stats))
+                        {
+                          path . clear ();
+                          n = 0;
+                        }
+                      else if (Max_Paths < unsigned (n))
+                        {
+                          if (Print_Trace)
+                            printf ("  Found more than %d paths--ignoring\n", Max_Paths);
+                          path . clear ();
+                          n = 0;
+                        }
+                      else if (Print_Trace)
+                        printf ("  Found %d paths\n", n);
+                    }
+                  else
+                    {
+                      Report_Budget (stats);
+                      path . clear ();
+                      n = 0;
+                    }
+
+                  if (0 < n)
+                    {
+                      int  path_sep, read_sep;
+
+                      j = Choose_Best_Path (seq, last_match - 1, i - 1, path, dist);
+                      if (Print_Trace)
+                        printf ("best path= %d  score= %d\n", j, dist);
+                      corr . lo = last_match + Kmer_Len - 1;
+                      corr . hi = i - 1;
+                      corr . kind = 'G';
+                      read_sep = corr . hi - corr . lo;
+                        // offset between start & end kmers on read to be corrected
+                      path_sep = path [j] . length () - 2 * Kmer_Len;
+                        // offset between those kmers on correct path
+                      if (0 <= read_sep && 0 <= path_sep)
+                        { // simple replacement
+                          corr . replacement
+                            = path [j] . substr (Kmer_Len, path_sep);
+                        }
+                      else if (read_sep < path_sep)
+                        { // read_sep is negative and need insertion
+                          corr . hi = corr . lo;
+                          corr . replacement
+                            = path [j] . substr (Kmer_Len, path_sep - read_sep);
+                        }
+                      else if (path_sep < read_sep)
+                        { // path_sep is negative and need deletion
+                          corr . hi = corr . lo + read_sep - path_sep;
+                          corr . replacement = "";
+                        }
+                      else
+                        { // this can't happen--the read & path sequences would be
+                          // the same and there wouldn't be a gap to fix
+                          fprintf (stderr, "read_sep= %d  path_sep= %d\n",
+                                   read_sep, path_sep);
+                          assert (false);
+                        }
+                      
+                      if (Print_Trace && 0 < Verbose)
+                        {
+                          char  * old;
+
+
+                          old = (char *) malloc (1 + corr . hi - corr . lo);
+                          strncpy (old, seq + corr . lo, corr . hi - corr . lo);
+                          old [corr . hi - corr . lo] = '\0';
+                          printf ("Replace pos %d..%d\n"
+                                  "     >%s<\n"
+                                  "with >%s<\n",
+                                  corr . lo, corr . hi, old,
+                                  corr . replacement . c_str ());
+                          free (old);
+                        }
+                      correct . push_back (corr);
+                    }
+                }
+              else if (Print_Trace)
+                printf ("  Gap too long--skipping\n");
+            }
+          last_match = i;
+        }
+
+      // Advance to next character
+      if (i < num_kmers)
+        {
+          unsigned  a = packed . Base (i + Kmer_Len - 1);
+
+          kmer_hash -> Fwd_Shift_In_Bits (fbin, a);
+          kmer_hash -> Rev_Shift_In_Bits (rbin, 3 - a);
+        }
+    }
+
+  if (0 < last_match && last_match < num_kmers
+        && dirty_ct [last_match - 1] < dirty_ct [num_kmers])
+    {
+      j = seq_len - Kmer_Len + 1 - last_match;
+      max_extend = int (1.1 * j + 10);
+        // have j unmatched kmers; allow extra characters
+        // in extension in case of indels
+
+      if (Print_Trace)
+        printf ("Try right extension  last_match= %d  seq_len= %d  max_extend= %d\n",
+                last_match, seq_len, max_extend);
+
+      Start_Budget ();
+      Get_Right_Extensions (seq, last_match - 1, seq_len, path, kmer_hash,
+                            max_extend);
+
+      n = path . size ();
+      if (Report_Budget (stats))
+        {
+          path . clear ();
+          n = 0;
+        }
+      else if (Max_Paths < unsigned (n))
+        {
+          if (Print_Trace)
+            printf ("  Found more than %d extensions--ignoring\n", Max_Paths);
+          path . clear ();
+          n = 0;
+        }
+      else if (Print_Trace)
+        printf ("  Found %d right extensions\n", n);
+
+      if (0 < n)
+        {
+          bool  made_correction = false;
+          int  seq_hi, path_hi;
+
+          j = Choose_Best_Right_Extension (seq + last_match + Kmer_Len - 1,
+                                           path, dist, seq_hi, path_hi);
+
+          if (Print_Trace)
+            printf ("j= %d\n", j);
+          if (j < 0)
+            erate = DBL_MAX;
+          else
+            erate = (2.0 * dist) / (seq_hi + path_hi);
+          if (erate <= MAX_EXTENSION_ERATE)
+            {
+              corr . lo = last_match + Kmer_Len - 1;
+              corr . hi = corr . lo + seq_hi;
+              corr . kind = 'R';
+              corr . replacement = path [j] . substr (0, path_hi);
+              correct . push_back (corr);
+              made_correction = true;
+            }
+          if (0 < j && Print_Trace && 0 < Verbose)
+            {
+              string  s, t;
+
+              printf ("Best right extension is path j= %d  dist= %d"
+                      "  erate= %.2f%%\n",
+                      j, dist, 100.0 * erate);
+              t = seq;
+              s = t . substr (last_match + Kmer_Len - 1, seq_hi);
+              printf ("Replace:  %s\n", s . c_str ());
+              s = path [j] . substr (0, path_hi);
+              printf ("   with:  %s\n", corr . replacement . c_str ());
+              if (made_correction)
+                printf ("  Correction made\n");
+              else
+                printf ("  Correction NOT made\n");
+            }
+        }
+    }
+
+  if (Print_Trace && 0 < Verbose)
+    printf ("Number of correction segments is %lu\n", correct . size ());
+
+  return;
+}
+
+
 static bool  Find_Left_Extension
   (char * curr_path, int step, int max_steps, const char * fmer,
    const char * rmer, vector <string> & path, Kmer_Hash_t <Kmer_Info_t> * kmer_hash)
@@ -680,10 +959,13 @@ static bool  Find_Left_Extension
   bool  extended, ok;
   int  i;
 
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     printf ("Find_Left_Extension:  step= %d  max_steps= %d\n  fmer= %s\n",
             step, max_steps, fmer);
 
+  if (! Charge_Budget ())
+    return false;
+
   ok = true;
   extended = false;
   if (0 < step)
@@ -702,7 +984,7 @@ static bool  Find_Left_Extension
             continue;
           else
             {
-              if (1 < Verbose)
+              if (Print_Trace && 1 < Verbose)
                 printf ("  step= %d  added_ch= %c  freq= %d\n", step, FWD_ACGT [i],
                         p -> freq);
               curr_path [step - 1] = FWD_ACGT [i];
@@ -719,7 +1001,7 @@ static bool  Find_Left_Extension
   if (! extended && step != max_steps)
     { // Add curr_path to path
       path . push_back (curr_path + step);
-      if (0 < Verbose)
+      if (Print_Trace && 0 < Verbose)
         {
           printf ("Extension ended at step %d\n", step);
           printf ("Path extension is:\n  %s\n", curr_path + step);
@@ -735,9 +1017,11 @@ Kmer_Info_t  * Find_Mer
 
 // Search for the kmer with forward-strand sequence fmer and reverse-strand sequence
 // rmer in kmer_hash.  If found return a pointer to its corresponding information
-// entry; otherwise, return NULL
+// entry; otherwise, return NULL.  Kmers removed by graph cleaning are
+// treated as not found.
 
 {
+  Kmer_Info_t  * p;
   const char  * s;
 
   if (strcmp (fmer, rmer) < 0)
@@ -745,7 +1029,34 @@ Kmer_Info_t  * Find_Mer
   else
     s = rmer;
 
-  return kmer_hash -> Find (s);
+  p = kmer_hash -> Find (s);
+  if (p != NULL && p -> removed)
+    return NULL;
+
+  return p;
+}
+
+
+Kmer_Info_t  * Find_Mer
+  (Kmer_Hash_t <Kmer_Info_t> * kmer_hash, const Binary_Mer_t & fbin,
+   const Binary_Mer_t & rbin)
+
+// Search for the kmer with binary forward-strand form fbin and reverse-strand
+// form rbin in kmer_hash.  If found return a pointer to its corresponding
+// information entry; otherwise, return NULL.  Kmers removed by graph
+// cleaning are treated as not found.
+
+{
+  Kmer_Info_t  * p;
+
+  if (Binary_Less (fbin, rbin))
+    p = kmer_hash -> Find (fbin);
+  else
+    p = kmer_hash -> Find (rbin);
+  if (p != NULL && p -> removed)
+    return NULL;
+
+  return p;
 }
 
 
@@ -767,21 +1078,23 @@ static bool  Find_Path
   bool  ok;
   int  i;
 
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     printf ("Start step= %d  max_steps= %d\n", step, max_steps);
   if (step == max_steps)
     return true;
+  if (! Charge_Budget ())
+    return false;
 
   curr_path [step + Kmer_Len] = '\0';
   strcpy (fmer, curr_path + step);
 
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     printf ("fmer= %s\n", fmer);
 
   if (strcmp (fmer, end_mer) == 0)
     { // found the end_mer
       path . push_back (curr_path);
-      if (0 < Verbose)
+      if (Print_Trace && 0 < Verbose)
         {
           printf ("Found end_mer at step %d\n", step);
           printf ("Path extension is:\n  %s\n", curr_path + Kmer_Len);
@@ -803,14 +1116,14 @@ static bool  Find_Path
       p = Find_Mer (kmer_hash, fmer, rmer);
       if (p == NULL)
         continue;
-      if (1 < Verbose)
+      if (Print_Trace && 1 < Verbose)
         printf ("  step= %d  added_ch= %c  freq= %d\n", step, FWD_ACGT [i],
                 p -> freq);
       curr_path [step + Kmer_Len] = FWD_ACGT [i];
       ok = Find_Path (curr_path, step + 1, max_steps, end_mer, path, kmer_hash);
     }
 
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     printf ("Back from step= %d\n", step);
 
   return ok;
@@ -836,10 +1149,13 @@ static bool  Find_Right_Extension
   bool  extended, ok;
   int  i;
 
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     printf ("Find_Right_Extension:  step= %d  max_steps= %d\n  fmer= %s\n",
             step, max_steps, fmer);
 
+  if (! Charge_Budget ())
+    return false;
+
   ok = true;
   extended = false;
   if (step < max_steps)
@@ -857,7 +1173,7 @@ static bool  Find_Right_Extension
           if (p == NULL)
             continue;
 
-          if (1 < Verbose)
+          if (Print_Trace && 1 < Verbose)
             printf ("  step= %d  added_ch= %c  freq= %d\n", step, FWD_ACGT [i],
                     p -> freq);
           curr_path [step] = FWD_ACGT [i];
@@ -874,7 +1190,7 @@ static bool  Find_Right_Extension
     { // Add curr_path to path
       curr_path [step] = '\0';
       path . push_back (curr_path);
-      if (0 < Verbose)
+      if (Print_Trace && 0 < Verbose)
         {
           printf ("Extension ended at step %d\n", step);
           printf ("Path extension is:\n  %s\n", curr_path);
@@ -902,7 +1218,7 @@ static void  Get_Left_Extensions
 
   max_steps = Min (MAX_EXTENSION_STEPS, max_extend);
 
-  if (0 < Verbose)
+  if (Print_Trace && 0 < Verbose)
     printf ("Get_Left_Extensions:  fmer= %s  max_steps= %d\n", fmer, max_steps);
 
   path . clear ();
@@ -912,7 +1228,7 @@ static void  Get_Left_Extensions
   ok = Find_Left_Extension (curr_path, max_steps, max_steps, fmer, rmer,
                        path, kmer_hash);
 
-  if (0 < Verbose)
+  if (Print_Trace && 0 < Verbose)
     {
       int  i, n = path . size ();
 
@@ -982,7 +1298,7 @@ static void  Get_Right_Extensions
   strcpy (rmer, fmer);
   Reverse_Complement (rmer);
 
-  if (0 < Verbose)
+  if (Print_Trace && 0 < Verbose)
     printf ("Get_Right_Extensions:  from= %d\n  fmer= %s  max_steps= %d\n",
             from, fmer, max_steps);
 
@@ -990,7 +1306,7 @@ static void  Get_Right_Extensions
 
   ok = Find_Right_Extension (curr_path, 0, max_steps, fmer, rmer, path, kmer_hash);
   
-  if (0 < Verbose)
+  if (Print_Trace && 0 < Verbose)
     {
       int  i, n = path . size ();
 
@@ -1016,9 +1332,27 @@ static void  Parse_Command_Line
   optarg = NULL;
 
   while  (! errflg
-          && ((ch = getopt (argc, argv, "g:hV:x:")) != EOF))
+          && ((ch = getopt (argc, argv, "b:c:e:g:hp:P:qQ:s:t:T:V:w:W:x:")) != EOF))
     switch  (ch)
       {
+      case  'b' :
+        Read_Batch = strtol (optarg, NULL, 10);
+        if (Read_Batch < 1)
+          {
+            fprintf (stderr, "ERROR:  Bad -b option (read batch) value %d\n",
+                     Read_Batch);
+            errflg = true;
+          }
+        break;
+
+      case  'c' :
+        Correction_Filename = optarg;
+        break;
+
+      case  'e' :
+        Max_Expansions = strtoul (optarg, NULL, 10);
+        break;
+
       case  'g' :
         Max_Gap = strtol (optarg, NULL, 10);
         break;
@@ -1027,10 +1361,52 @@ static void  Parse_Command_Line
         Usage ();
         exit (EXIT_SUCCESS);
 
+      case  'p' :
+        Max_Passes = strtoul (optarg, NULL, 10);
+        break;
+
+      case  'P' :
+        Max_Bubble_Len = strtol (optarg, NULL, 10);
+        break;
+
+      case  'q' :
+        Fastq_Mode = true;
+        break;
+
+      case  'Q' :
+        Min_Anchor_Qual = strtol (optarg, NULL, 10);
+        break;
+
+      case  's' :
+        Stats_Filename = optarg;
+        break;
+
+      case  't' :
+        Num_Threads = strtol (optarg, NULL, 10);
+        if (Num_Threads < 1)
+          {
+            fprintf (stderr, "ERROR:  Bad -t option (threads) value %d\n",
+                     Num_Threads);
+            errflg = true;
+          }
+        break;
+
+      case  'T' :
+        Max_Tip_Len = strtol (optarg, NULL, 10);
+        break;
+
       case  'V' :
         Verbose = strtol (optarg, NULL, 10);
         break;
 
+      case  'w' :
+        Max_Search_Seconds = strtod (optarg, NULL);
+        break;
+
+      case  'W' :
+        Cleaned_Kmer_Filename = optarg;
+        break;
+
       case  'x' :
         Max_Paths = strtol (optarg, NULL, 10);
         if (Max_Paths < 1)
@@ -1068,9 +1444,11 @@ static bool  Path_Exists
 // the length of the shortest path; otherwise, return false
 // and set len to -1.  Note that we don't check if the start kmer
 // (at position from) or end kmer (at position to) are in kmer_hash.
+// Kmers visited are kept in the used hash in forward orientation; its
+// binary form differs from kmer_hash's so it's always given strings.
 
 {
-  Kmer_Hash_t <Kmer_Info_t>  used (Kmer_Len, Hash_Prefix_Chars);
+  Kmer_Hash_t <Kmer_Info_t>  used (Kmer_Len, USED_HASH_PREFIX_CHARS);
   std :: queue <Kmer_Ref_t>  kmer_queue;
   Kmer_Info_t  dummy, * p;
   Kmer_Ref_t  kref;
@@ -1105,10 +1483,10 @@ static bool  Path_Exists
       kmer_hash -> Kmer_To_Binary (start_mer, kref . bin);
       kref . len = 0;
       kmer_queue . push (kref);
-      used . Insert (kref . bin, dummy);
+      used . Insert (start_mer, dummy);
 
       found = false;
-      while (! kmer_queue . empty () && ! found)
+      while (! kmer_queue . empty () && ! found && Charge_Budget ())
         {
           // pop front of queue
           kref = kmer_queue . front ();
@@ -1116,7 +1494,7 @@ static bool  Path_Exists
           len = kref . len + 1;
 
           kmer_hash -> Binary_To_Kmer (kref . bin, fmer, true);
-if (1 < Verbose)
+if (Print_Trace && 1 < Verbose)
   {
     printf ("queue size= %lu  len= %d\n", kmer_queue . size (), len);
     printf ("extracted kmer= %s\n", fmer);
@@ -1141,7 +1519,7 @@ if (1 < Verbose)
               // if not in kmer_hash, skip it
               rmer [0] = REV_ACGT [i];
               p = Find_Mer (kmer_hash, fmer, rmer);
-if (1 < Verbose)
+if (Print_Trace && 1 < Verbose)
   {
     printf ("fmer= %s\n", fmer);
     printf ("rmer= %s\n", rmer);
@@ -1153,22 +1531,25 @@ if (1 < Verbose)
 
               // if not used add to kmer_queue and to used
               // with a distance one more than front element distance
-              p = Find_Mer (& used, fmer, rmer);
+              p = used . Find (fmer);
               if (p == NULL && len < max_steps)
                 {
                   kmer_hash -> Kmer_To_Binary (fmer, kref . bin);
                   kref . len = len;
                   kmer_queue . push (kref);
-                  used . Insert (kref . bin, dummy);
+                  used . Insert (fmer, dummy);
                 }
             }
         }
     }
 //**ALD Left off here
-  if (found)
-    printf ("Found shortest path, len= %d\n", len);
-  else
-    printf ("No path found\n");
+  if (Print_Trace)
+    {
+      if (found)
+        printf ("Found shortest path, len= %d\n", len);
+      else
+        printf ("No path found\n");
+    }
 
   used . Clear ();
 
@@ -1192,12 +1573,12 @@ static int  Prefix_Edit_Dist
 
 
 {
-  static short int  * space = NULL;
-  static int  save_sz = -1;
+  static thread_local short int  * space = NULL;
+  static thread_local int  save_sz = -1;
   int  best_d, from, max_errs, mx, sz;
   int  d, e, i, j;
 
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     {
       printf ("Prefix_Edit_Dist:\n");
       printf ("  a= %-.20s  m= %d\n", a, m);
@@ -1226,7 +1607,7 @@ static int  Prefix_Edit_Dist
       b_hi = i;
       return  0;
     }
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     printf ("e= %d  d= %d  S= %d  max_errs= %d\n",
             0, 0, S (0, 0), max_errs);
 
@@ -1255,7 +1636,7 @@ static int  Prefix_Edit_Dist
             i ++;
           S (e, d) = i;
 
-          if (1 < Verbose)
+          if (Print_Trace && 1 < Verbose)
             printf ("e= %d  d= %d  from= %d  S= %d  sub= %d\n",
                     e, d, from, S (e, d), e * (e + 1) + d);
 
@@ -1281,6 +1662,259 @@ static int  Prefix_Edit_Dist
 }
 
 
+static void  Print_Corrections
+  (FILE * fp, const string & hdr, const vector <Correction_t> & correct)
+
+// Print to fp one tab-separated line for each entry in correct:  the
+// first word of hdr, the repair pass that made it, the lo and hi positions (0-based gap
+// coordinates in the sequence as it was at the start of that pass),
+// the type of correction ('L' left extension, 'G' gap, 'R' right extension)
+// and the replacement string, or "-" if it's empty.
+
+{
+  string  id;
+  int  i, n;
+
+  id = hdr . substr (0, hdr . find_first_of (" \t"));
+
+  n = correct . size ();
+  for (i = 0; i < n; i ++)
+    fprintf (fp, "%s\t%d\t%d\t%d\t%c\t%s\n", id . c_str (), correct [i] . pass,
+             correct [i] . lo,
+             correct [i] . hi, correct [i] . kind,
+             (correct [i] . replacement . empty () ? "-"
+                : correct [i] . replacement . c_str ()));
+
+  return;
+}
+
+
+static void  Print_Stats
+  (FILE * fp, const string & hdr, int seq_len, const Repair_Stats_t & stats)
+
+// Print to fp one tab-separated line with the first word of hdr, the
+// original sequence length seq_len and the counts and time in stats.
+
+{
+  fprintf (fp, "%s\t%d\t%d\t%d\t%d\t%lu\t%d\t%.3f\n",
+           hdr . substr (0, hdr . find_first_of (" \t")) . c_str (),
+           seq_len, stats . passes, stats . searches, stats . exhausted,
+           stats . expansions, stats . corrections, stats . seconds);
+
+  return;
+}
+
+
+static void  Repair_Read
+  (Read_t & r, FILE * fp, Kmer_Hash_t <Kmer_Info_t> * kmer_hash)
+
+// Run by the pipeline workers of Repair_Reads.  Repair r in place using
+// kmer_hash and print it to fp, as fastq in fastq mode, and otherwise
+// as fasta with "  corrected" added to the header if it was changed.
+// Reads shorter than Kmer_Len are marked skipped.  A skipped fastq read
+// is printed unchanged; a skipped fasta sequence is not printed at all.
+// The reader exits on a truncated fastq record, so qualities always
+// match the sequence length here.
+
+{
+  double  start;
+  int  len;
+
+  start = Wall_Time ();
+  r . correct . clear ();
+  r . stats = Repair_Stats_t ();
+  r . len = len = r . seq . length ();
+  r . skipped = (len < Kmer_Len);
+
+  if (r . skipped && ! Fastq_Mode)
+    {
+      fprintf (stderr,
+               "Skipping sequence %s with length %d shorter than kmer length %d\n",
+               r . hdr . c_str (), len, Kmer_Len);
+      return;
+    }
+
+  if (! r . skipped)
+    {
+      Upper_Case_Seq (& r . seq [0], len);
+      Repair_Sequence (r . seq, (Fastq_Mode ? & r . qual : NULL), r . hdr,
+                       kmer_hash, r . correct, r . stats);
+      r . stats . seconds = Wall_Time () - start;
+    }
+
+  if (Fastq_Mode)
+    Fastq_Print (fp, r . seq . c_str (), r . qual . c_str (), r . hdr . c_str ());
+  else if (0 < r . stats . corrections)
+    Fasta_Print (fp, r . seq . c_str (), (r . hdr + "  corrected") . c_str ());
+  else
+    Fasta_Print (fp, r . seq . c_str (), r . hdr . c_str ());
+
+  return;
+}
+
+
+static void  Repair_Reads
+  (Seq_Reader_t * seq_reader, Kmer_Hash_t <Kmer_Info_t> * kmer_hash,
+   FILE * correct_fp, FILE * stats_fp, Repair_Stats_t & total_stats)
+
+// Read fasta or fastq records from seq_reader, repair them with
+// Num_Threads worker threads using the kmers in kmer_hash, and print
+// the corrected records to stdout in input order.  At most Read_Batch
+// records are in progress at once so memory stays bounded, and records
+// and their string buffers are reused.  Print corrections to correct_fp
+// and per-read stats to stats_fp if they're not NULL.  Add counts to
+// total_stats.  In fastq mode report reads/sec to stderr periodically
+// and at the end.
+
+{
+  Seq_Pipeline_t <Read_t>  pipeline;
+  double  start, last_report, now;
+  long unsigned  num_reads = 0;
+
+  pipeline . process = [kmer_hash] (Read_t & r, FILE * fp)
+    {
+      Repair_Read (r, fp, kmer_hash);
+    };
+
+  // Done in input order by the writer, so needs no locking
+  pipeline . finish = [&] (Read_t & r)
+    {
+      if (r . skipped && ! Fastq_Mode)
+        return;
+
+      if (correct_fp != NULL)
+        Print_Corrections (correct_fp, r . hdr, r . correct);
+      if (! Fastq_Mode && 0 < r . stats . corrections)
+        r . hdr . append ("  corrected");
+      if (stats_fp != NULL)
+        Print_Stats (stats_fp, r . hdr, r . len, r . stats);
+      Add_Stats (total_stats, r . stats);
+
+      num_reads ++;
+      if (Fastq_Mode && (now = Wall_Time ()) - last_report >= PROGRESS_INTERVAL)
+        {
+          fprintf (stderr, " %s reads  %.0f reads/sec\n", Commatize (num_reads),
+                   num_reads / (now - start));
+          last_report = now;
+        }
+    };
+
+  start = last_report = Wall_Time ();
+  pipeline . Run (* seq_reader, stdout, Num_Threads, Read_Batch);
+
+  if (Fastq_Mode)
+    {
+      now = Wall_Time ();
+      fprintf (stderr, "Reads processed:  %s in %.1f sec  (%.0f reads/sec)\n",
+               Commatize (num_reads), now - start,
+               (start < now ? num_reads / (now - start) : 0.0));
+    }
+
+  return;
+}
+
+
+static void  Repair_Sequence
+  (string & seq_string, string * qual, const string & seq_hdr,
+   Kmer_Hash_t <Kmer_Info_t> * kmer_hash, vector <Correction_t> & correct,
+   Repair_Stats_t & stats)
+
+// Make up to Max_Passes repair passes over seq_string, which must be
+// uppercase and at least Kmer_Len long, using the kmers in kmer_hash.
+// If qual is not NULL it has the fastq quality characters of seq_string
+// and is kept in step with it; kmers containing a base with quality
+// below Min_Anchor_Qual then are never used as anchors.  Put in correct
+// all corrections made, in order, and add search counts to stats.
+// seq_hdr is used only for the trace.
+
+{
+  vector <Correction_t>  pass_correct;
+  vector <int>  match_ct;
+  vector <char>  dirty;
+  int  i, last_low, n, num_kmers, pass, seq_len;
+
+  correct . clear ();
+  seq_len = seq_string . length ();
+  num_kmers = seq_len - Kmer_Len + 1;
+
+  // The first pass looks up every kmer and searches every gap.  Later
+  // passes only redo the parts changed by the previous pass.
+  match_ct . assign (num_kmers, -1);
+  dirty . assign (num_kmers, 1);
+
+  if (qual != NULL && 0 < Min_Anchor_Qual)
+    {
+      // Leave kmers with a low-quality base unmatched and clean so
+      // they're never looked up.  last_low is the position of the
+      // most recent low-quality base.
+      last_low = -1;
+      for (i = 0; i < seq_len; i ++)
+        {
+          if ((* qual) [i] - FASTQ_QUALITY_OFFSET < Min_Anchor_Qual)
+            last_low = i;
+          if (Kmer_Len <= i + 1 && i - Kmer_Len < last_low)
+            dirty [i - Kmer_Len + 1] = 0;
+        }
+    }
+
+  for (pass = 1; ; pass ++)
+    {
+      if (! Print_Trace)
+        ;
+      else if (pass == 1)
+        printf ("\n#%s  len=%d\n", seq_hdr . c_str (), seq_len);
+      else
+        printf ("\n#%s  len=%d  pass=%d\n", seq_hdr . c_str (),
+                int (seq_string . length ()), pass);
+
+      Find_Corrections (seq_string, kmer_hash, match_ct, dirty, pass_correct,
+                        stats);
+
+      n = pass_correct . size ();
+      for (i = 0; i < n; i ++)
+        {
+          pass_correct [i] . pass = pass;
+          correct . push_back (pass_correct [i]);
+        }
+
+      if (0 < n)
+        Apply_Corrections (seq_string, qual, pass_correct, match_ct, dirty);
+      if (n == 0 || unsigned (pass) == Max_Passes
+            || (Max_Passes == 0 && pass == MAX_CONVERGE_PASSES)
+            || int (seq_string . length ()) < Kmer_Len)
+        break;
+    }
+  stats . passes = pass;
+  stats . corrections = correct . size ();
+
+  return;
+}
+
+
+static bool  Report_Budget
+  (Repair_Stats_t & stats)
+
+// Add the node expansions of the search that just finished to stats.
+// If that search was stopped by its budget in global Gap_Budget, log
+// it, count it in stats and return true; otherwise, return false.
+
+{
+  stats . searches ++;
+  stats . expansions += Gap_Budget . expansions;
+
+  if (! Gap_Budget . exhausted)
+    return false;
+
+  stats . exhausted ++;
+  if (Print_Trace)
+    printf ("  Budget-exhausted (%s) after %lu expansions  %.3f sec--ignoring\n",
+            (Gap_Budget . exhausted == 'n' ? "nodes" : "time"),
+            Gap_Budget . expansions, Wall_Time () - Gap_Budget . start_time);
+
+  return true;
+}
+
+
 void  Reverse_Complement
   (char * s)
 
@@ -1306,6 +1940,20 @@ void  Reverse_Complement
 }
 
 
+static void  Start_Budget
+  (void)
+
+// Reset global Gap_Budget for the start of a new gap or extension search.
+
+{
+  Gap_Budget . expansions = 0;
+  Gap_Budget . start_time = Wall_Time ();
+  Gap_Budget . exhausted = '\0';
+
+  return;
+}
+
+
 static int  Suffix_Edit_Dist
   (const char * a, int a_hi, const char * b, int & a_lo, int & b_lo)
 
@@ -1315,14 +1963,14 @@ static int  Suffix_Edit_Dist
 // the positions in a and b, respectively, where the match ends.
 
 {
-  static short int  * space = NULL;
-  static int  save_sz = -1;
+  static thread_local short int  * space = NULL;
+  static thread_local int  save_sz = -1;
   const char  * aa, * bb;
     // point to right ends of a & b, resp, to make it easier to go left
   int  best_d, from, max_errs, mx, sz;
   int  d, e, i, j, m, n;
 
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     printf ("Suffix_Edit_Dist:\n");
   m = a_hi + 1;
   n = strlen (b);
@@ -1352,7 +2000,7 @@ static int  Suffix_Edit_Dist
       b_lo = n - i;
       return  0;
     }
-  if (1 < Verbose)
+  if (Print_Trace && 1 < Verbose)
     printf ("e= %d  d= %d  S= %d\n", 0, 0, S (0, 0));
 
   for (e = 1; e <= max_errs; e ++)
@@ -1385,7 +2033,7 @@ static int  Suffix_Edit_Dist
               b_lo = n - i - d;
               return  e;
             }
-          if (1 < Verbose)
+          if (Print_Trace && 1 < Verbose)
             printf ("e= %d  d= %d  from= %d  S= %d  sub= %d\n",
                     e, d, from, S (e, d), e * (e + 1) + d);
 
@@ -1415,8 +2063,9 @@ static void  Usage
     "USAGE:  kmer-repair [options] <sequence-file> <kmer-counts>\n"
     "\n"
     "Read a list of kmers with counts, in the format produced\n"
-    "by 'jellyfish dump -c' from <kmer-counts>.  Then read a DNA\n"
-    "multi-fasta sequence file from <sequence-file> and replace\n"
+    "by 'jellyfish dump -c' from <kmer-counts>.  Then read DNA\n"
+    "multi-fasta or fastq sequences, which may be gzip-compressed, from\n"
+    "<sequence-file> and replace\n"
     "regions in sequence not matched by kmers with the closest sequence\n"
     "obtained by a path of consecutive kmers connecting the kmers matching\n"
     "the flanks of the unmatched section.  Either of <sequence-file>\n"
@@ -1424,10 +2073,46 @@ static void  Usage
     "is read from stdin.  Output goes to stdout.\n"
     "\n"
     "Options:\n"
+    " -b <n>\n"
+    "    Have at most <n> records read but not yet written at a time\n"
+    " -c <f>\n"
+    "    Write one tab-separated line per correction (id, pass, lo, hi, type,\n"
+    "    and replacement) to file <f> and print only the corrected sequences\n"
+    "    to stdout.  The per-kmer trace is still printed if -V is given\n"
+    " -e <n>\n"
+    "    Abandon any gap or extension search after expanding <n> kmer nodes\n"
+    " -g <n>\n"
+    "    Only try to correct unmatched gaps of at most <n> kmers\n"
     " -h\n"
     "    Print this message\n"
+    " -p <n>\n"
+    "    Make up to <n> repair passes over each sequence, re-searching only\n"
+    "    near corrections made by the previous pass.  0 means repeat until\n"
+    "    a pass makes no corrections\n"
+    " -P <n>\n"
+    "    Before repairing, pop bubbles in the kmer graph by removing weak\n"
+    "    branches of at most <n> kmers\n"
+    " -q\n"
+    "    <sequence-file> is fastq.  Write corrected reads as fastq in input\n"
+    "    order, with no trace, giving inserted bases quality 30.  This is\n"
+    "    the default when <sequence-file> is detected to be fastq\n"
+    " -Q <n>\n"
+    "    In fastq mode, don't use kmers with a base of phred quality below <n>\n"
+    "    as anchors for corrections\n"
+    " -s <f>\n"
+    "    Write per-sequence search counts and timing to file <f>\n"
+    " -t <n>\n"
+    "    Repair sequences with <n> threads.  Output stays in input order.\n"
+    "    With more than one thread no trace is printed\n"
+    " -T <n>\n"
+    "    Before repairing, remove weak tips of at most <n> kmers from the\n"
+    "    kmer graph\n"
     " -V <n>\n"
     "    Set verbose level to <n>; higher values for more debugging output\n"
+    " -w <x>\n"
+    "    Abandon any gap or extension search after <x> seconds of wall time\n"
+    " -W <f>\n"
+    "    Write the kmer counts left after -P and -T cleaning to file <f>\n"
     " -x <n>\n"
     "    Set max number of sequences used for extension/correction to <n>\n"
     "\n");
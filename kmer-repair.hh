@@ -15,8 +15,12 @@
 #include  "delcher.hh"
 #include  "fasta.hh"
 #include  "kmer-hash.hh"
+#include  "kmer-clean.hh"
+#include  "seq-pipeline.hh"
 
 
+const int  CORRECTED_BASE_QUAL = 30;
+  // Phred quality given to bases inserted by a correction in fastq output
 const int  DEFAULT_HASH_PREFIX_CHARS = 10;
   // Default prefix length of kmers directly indexed in array
 const int  DEFAULT_MAX_GAP = 500;
@@ -24,6 +28,8 @@ const int  DEFAULT_MAX_GAP = 500;
 const unsigned  DEFAULT_MAX_PATHS = 500;
   // Default maximum number of sequences that can be used for
   // extension or correction
+const int  DEFAULT_READ_BATCH = 4096;
+  // Default most records read but not yet written at once
 const double  MAX_EXTENSION_ERATE = 0.12;
   // Maximum allowed alignment error rate in doing extensions
 const int  MAX_EXTENSION_STEPS = 500;
@@ -31,6 +37,17 @@ const int  MAX_EXTENSION_STEPS = 500;
   // before the first match or after the last match
 const int  MAX_LINE = 1000;
   // Max length of input lines/strings
+const int  MAX_CONVERGE_PASSES = 50;
+  // Most repair passes made over a sequence when repeating until no
+  // more corrections are made
+const unsigned  BUDGET_CLOCK_INTERVAL = 1024;
+  // Number of node expansions between checks of the wall clock
+  // when a per-gap time limit is set
+const double  PROGRESS_INTERVAL = 10.0;
+  // Seconds between reports of reads/sec in fastq mode
+const int  USED_HASH_PREFIX_CHARS = 8;
+  // Prefix length of the hash of kmers visited in one shortest-path search.
+  // Much smaller than the main hash so it's cheap to create for each gap.
 
 static const char  COMPLEMENT_TABLE []
   = "nnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnn"
@@ -51,6 +68,11 @@ struct Correction_t
     // 3 and 4 (counting from 1) is lo=3, hi=3.
   string  replacement;
     // the string with which to replace that part of the ref sequence
+  char  kind;
+    // 'L' for a left extension, 'G' for a gap between kmer matches,
+    // 'R' for a right extension
+  int  pass;
+    // the repair pass that made this correction
 };
 
 struct Kmer_Info_t
@@ -58,11 +80,13 @@ struct Kmer_Info_t
   unsigned  freq : KMER_INFO_FREQ_BITS;
   unsigned  no_left_extension : 1;
   unsigned  no_right_extension : 1;
+  unsigned  removed : 1;    // true if removed as an error tip or bubble
 
   Kmer_Info_t ()
   {
     freq = 0;
     no_left_extension = no_right_extension = 0;
+    removed = 0;
   }
 };
 
@@ -72,7 +96,59 @@ struct Kmer_Ref_t
   int  len;
 };
 
+struct Search_Budget_t
+{
+  long unsigned  expansions;
+    // number of kmer nodes expanded so far in the current gap search
+  double  start_time;
+    // wall-clock time at which the current gap search began
+  char  exhausted;
+    // '\0' if still within limits; 'n' if the node-expansion limit was hit;
+    // 't' if the wall-time limit was hit
+};
+
+struct Repair_Stats_t
+{
+  int  passes;
+    // number of repair passes made
+  int  searches;
+    // number of gap/extension searches attempted
+  int  exhausted;
+    // number of those that were stopped for exceeding the search budget
+  int  corrections;
+    // number of corrections made
+  long unsigned  expansions;
+    // total kmer nodes expanded over all searches
+  double  seconds;
+    // wall-clock time spent repairing
+
+  Repair_Stats_t ()
+  {
+    passes = searches = exhausted = corrections = 0;
+    expansions = 0;
+    seconds = 0.0;
+  }
+};
 
+struct Read_t
+{
+  string  hdr, seq, qual;
+  int  len;
+    // length of seq as read, before any correction
+  bool  skipped;
+    // true if it was too short or malformed to repair
+  vector <Correction_t>  correct;
+  Repair_Stats_t  stats;
+};
+
+
+static void  Add_Stats
+  (Repair_Stats_t & total, const Repair_Stats_t & stats);
+static void  Apply_Corrections
+  (string & seq_string, string * qual, const vector <Correction_t> & correct,
+   vector <int> & match_ct, vector <char> & dirty);
+static bool  Charge_Budget
+  (void);
 static int  Choose_Best_Left_Extension
   (const char * seq, int hi, vector <string> & path, int & dist,
    int & seq_lo, int & path_lo);
@@ -85,11 +161,18 @@ char  Complement
   (char ch);
 static int  Edit_Dist
   (const char * a, const char * b);
+static void  Find_Corrections
+  (const string & seq_string, Kmer_Hash_t <Kmer_Info_t> * kmer_hash,
+   vector <int> & match_ct, const vector <char> & dirty,
+   vector <Correction_t> & correct, Repair_Stats_t & stats);
 static bool  Find_Left_Extension
   (char * curr_path, int step, int max_steps, const char * fmer,
    const char * rmer, vector <string> & path, Kmer_Hash_t <Kmer_Info_t> * kmer_hash);
 Kmer_Info_t  * Find_Mer
   (Kmer_Hash_t <Kmer_Info_t> * kmer_hash, const char * fmer, const char * rmer);
+Kmer_Info_t  * Find_Mer
+  (Kmer_Hash_t <Kmer_Info_t> * kmer_hash, const Binary_Mer_t & fbin,
+   const Binary_Mer_t & rbin);
 static bool  Find_Path
   (char * curr_path, int step, int max_steps, char * end_mer,
    vector <string> & path, Kmer_Hash_t <Kmer_Info_t> * kmer_hash);
@@ -112,8 +195,25 @@ static bool  Path_Exists
    Kmer_Hash_t <Kmer_Info_t> * kmer_hash);
 static int  Prefix_Edit_Dist
   (const char * a, int m, const char * b, int n, int & a_hi, int & b_hi);
+static void  Print_Corrections
+  (FILE * fp, const string & hdr, const vector <Correction_t> & correct);
+static void  Print_Stats
+  (FILE * fp, const string & hdr, int seq_len, const Repair_Stats_t & stats);
+static void  Repair_Read
+  (Read_t & r, FILE * fp, Kmer_Hash_t <Kmer_Info_t> * kmer_hash);
+static void  Repair_Reads
+  (Seq_Reader_t * seq_reader, Kmer_Hash_t <Kmer_Info_t> * kmer_hash,
+   FILE * correct_fp, FILE * stats_fp, Repair_Stats_t & total_stats);
+static void  Repair_Sequence
+  (string & seq_string, string * qual, const string & seq_hdr,
+   Kmer_Hash_t <Kmer_Info_t> * kmer_hash, vector <Correction_t> & correct,
+   Repair_Stats_t & stats);
+static bool  Report_Budget
+  (Repair_Stats_t & stats);
 void  Reverse_Complement
   (char * s);
+static void  Start_Budget
+  (void);
 static int  Suffix_Edit_Dist
   (const char * a, int a_hi, const char * b, int & a_lo, int & b_lo);
 static void  Usage
@@ -28,6 +28,8 @@ const char  * Kmer_Count_Filename;
   // Name of file from which to read kmer counts
 int  Kmer_Len = -1;
   // Length of kmers
+int  Num_Threads = 1;
+  // Number of worker threads tracing sequences, set by -t option
 const char  * Sequence_Filename;
   // Name of file with DNA fasta sequences
 
@@ -38,19 +40,18 @@ int  main
 {
   FILE  * sequence_fp, * kmer_count_fp;
   Kmer_Hash_t <Kmer_Info_t>  * kmer_hash;
-  string  seq_string, seq_hdr;
   Kmer_Info_t  info;
-  char  fmer [MAX_LINE], rmer [MAX_LINE];
-  char  a [MAX_LINE], b [MAX_LINE], s [MAX_LINE];
-  const char  * seq;
+  char  s [MAX_LINE];
   unsigned  max_count;
-  int  ct, seq_len;
-  int  i, j;
+  int  ct;
+  int  i;
 
   Verbose = 0;
 
   Parse_Command_Line (argc, argv);
 
+  Fasta_Buffer_Output (stdout);
+
   if (strcmp (Sequence_Filename, "-") == 0)
     sequence_fp = stdin;
   else
@@ -103,84 +104,21 @@ int  main
 #endif
     }
   fprintf (stderr, "Total counts read = %d\n", i);
+  if (0 < Verbose)
+    fprintf (stderr, "Sequence encoding kernel:  %s\n", Encode_Seq_Kernel ());
 
   if (kmer_count_fp != stdin)
     fclose (kmer_count_fp);
 
-  // Read and process the fasta sequences
-  while (Fasta_Read (sequence_fp, seq_string, seq_hdr))
-    {
-      seq_len = seq_string . length ();
-      if (seq_len < Kmer_Len)
-        {
-          fprintf (stderr,
-                   "Skipping sequence %s with length %d shorter than kmer length %d\n",
-                   seq_hdr . c_str (), seq_len, Kmer_Len);
-          continue;
-        }
-
-      for (i = 0; i < seq_len; i ++)
-        seq_string [i] = toupper (seq_string [i]);
-      seq = seq_string . c_str ();
-
-      printf ("\n>%s  len=%d\n", seq_hdr . c_str (), seq_len);
+  // Read and process the sequences, Num_Threads at a time
+  Seq_Reader_t  seq_reader (sequence_fp);
+  Seq_Pipeline_t <Seq_Record_t>  pipeline;
 
-      strncpy (fmer, seq, Kmer_Len);
-      fmer [Kmer_Len] = '\0';
-      strcpy (rmer, fmer);
-      Reverse_Complement (rmer);
-      
-      for (i = 1; i <= seq_len - Kmer_Len + 1; i ++)
-        {
-          Kmer_Info_t  * p;
-
-          p = Find_Mer (kmer_hash, fmer, rmer);
-          if (p == NULL)
-            ct = 0;
-          else
-            {
-              ct = p -> freq;
-              p -> hit = 1;
-            }
-
-          printf ("%5d  %s  %3d", i, fmer, ct);
-
-          // Look for alternate left characters
-          strcpy (a, fmer);
-          strcpy (b, rmer);
-          for (j = 0; j < 4; j ++)
-            if (fmer [0] != FWD_ACGT [j])
-              {
-                a [0] = FWD_ACGT [j];
-                b [Kmer_Len - 1] = REV_ACGT [j];
-                p = Find_Mer (kmer_hash, a, b);
-                if (p != NULL)
-                  printf ("  %c,%c,%-5d", 'L', a [0], p -> freq);
-              }
-
-          // Look for alternate right characters
-          a [0] = fmer [0];
-          b [Kmer_Len - 1] = rmer [Kmer_Len - 1];
-          for (j = 0; j < 4; j ++)
-            if (fmer [Kmer_Len - 1] != FWD_ACGT [j])
-              {
-                a [Kmer_Len - 1] = FWD_ACGT [j];
-                b [0] = REV_ACGT [j];
-                p = Find_Mer (kmer_hash, a, b);
-                if (p != NULL)
-                  printf ("  %c,%c,%-5d", 'R', a [Kmer_Len - 1], p -> freq);
-              }
-          printf ("\n");
-
-          // Advance to next character
-          a [Kmer_Len - 1] = fmer [Kmer_Len - 1];
-          b [0] = rmer [0];
-          strncpy (fmer, a + 1, Kmer_Len - 1);
-          strncpy (rmer + 1, b, Kmer_Len - 1);
-          fmer [Kmer_Len - 1] = seq [i + Kmer_Len - 1];
-          rmer [0] = Complement (fmer [Kmer_Len - 1]);
-        }
-    }
+  pipeline . process = [kmer_hash] (Seq_Record_t & r, FILE * fp)
+    {
+      Trace_Sequence (r, fp, kmer_hash);
+    };
+  pipeline . Run (seq_reader, stdout, Num_Threads);
 
   if (sequence_fp != stdin)
     fclose (sequence_fp);
@@ -204,21 +142,18 @@ char  Complement
 
 
 Kmer_Info_t  * Find_Mer
-  (Kmer_Hash_t <Kmer_Info_t> * kmer_hash, const char * fmer, const char * rmer)
+  (Kmer_Hash_t <Kmer_Info_t> * kmer_hash, const Binary_Mer_t & fbin,
+   const Binary_Mer_t & rbin)
 
-// Search for the kmer with forward-strand sequence fmer and reverse-strand sequence
-// rmer in kmer_hash.  If found return a pointer to its corresponding information
-// entry; otherwise, return NULL
+// Search for the kmer with binary forward-strand form fbin and reverse-strand
+// form rbin in kmer_hash.  If found return a pointer to its corresponding
+// information entry; otherwise, return NULL
 
 {
-  const char  * s;
-
-  if (strcmp (fmer, rmer) < 0)
-    s = fmer;
+  if (Binary_Less (fbin, rbin))
+    return kmer_hash -> Find (fbin);
   else
-    s = rmer;
-
-  return kmer_hash -> Find (s);
+    return kmer_hash -> Find (rbin);
 }
 
 
@@ -228,7 +163,7 @@ bool  Has_Positive_Hit
 // Return true iff info . hit > 0
 
 {
-  return (0 < info . hit);
+  return (0 < __atomic_load_n (& info . hit, __ATOMIC_RELAXED));
 }
 
 
@@ -245,13 +180,23 @@ static void  Parse_Command_Line
   optarg = NULL;
 
   while  (! errflg
-          && ((ch = getopt (argc, argv, "bhik:n:rV:")) != EOF))
+          && ((ch = getopt (argc, argv, "bhik:n:rt:V:")) != EOF))
     switch  (ch)
       {
       case  'h' :
         Usage ();
         exit (EXIT_SUCCESS);
 
+      case  't' :
+        Num_Threads = strtol (optarg, NULL, 10);
+        if (Num_Threads < 1)
+          {
+            fprintf (stderr, "ERROR:  Bad -t option (threads) value %d\n",
+                     Num_Threads);
+            errflg = true;
+          }
+        break;
+
       case  'V' :
         Verbose = strtol (optarg, NULL, 10);
         break;
@@ -298,6 +243,107 @@ void  Reverse_Complement
 }
 
 
+static void  Trace_Sequence
+  (Seq_Record_t & r, FILE * fp, Kmer_Hash_t <Kmer_Info_t> * kmer_hash)
+
+// Print to fp the count in kmer_hash of each kmer in sequence r and
+// any alternative left and right extensions of it that have counts.
+// Mark the kmers found as hit.  Run by the pipeline workers, so it may
+// run concurrently for different sequences.
+
+{
+  Packed_Seq_t  packed;
+  Binary_Mer_t  fbin, rbin, a, b;
+  const char  * seq;
+  unsigned  first, last;
+  int  ct, seq_len;
+  int  i, j;
+
+  seq_len = r . seq . length ();
+  if (seq_len < Kmer_Len)
+    {
+      fprintf (stderr,
+               "Skipping sequence %s with length %d shorter than kmer length %d\n",
+               r . hdr . c_str (), seq_len, Kmer_Len);
+      return;
+    }
+
+  // Make the sequence upper case and get its 2-bit codes in one pass.
+  // Kmers are made from the codes, shifting in one base at a time on
+  // both strands.
+  Encode_Seq (r . seq . c_str (), seq_len, packed, & r . seq [0]);
+  seq = r . seq . c_str ();
+
+  fprintf (fp, "\n>%s  len=%d\n", r . hdr . c_str (), seq_len);
+
+  kmer_hash -> Packed_To_Binary (packed, 0, fbin, rbin);
+
+  for (i = 1; i <= seq_len - Kmer_Len + 1; i ++)
+    {
+      Kmer_Info_t  * p;
+      bool  bad_left, bad_right;
+
+      // Kmers with N's or other non-ACGT characters have no count.
+      // Changing the first or last character can remove one.
+      bad_left = packed . Has_Bad (i, i - 1 + Kmer_Len);
+      bad_right = packed . Has_Bad (i - 1, i - 2 + Kmer_Len);
+
+      if (bad_left || bad_right)
+        p = NULL;
+      else
+        p = Find_Mer (kmer_hash, fbin, rbin);
+      if (p == NULL)
+        ct = 0;
+      else
+        {
+          ct = p -> freq;
+          __atomic_store_n (& p -> hit, 1, __ATOMIC_RELAXED);
+        }
+
+      fprintf (fp, "%5d  %.*s  %3d", i, Kmer_Len, seq + i - 1, ct);
+
+      // Look for alternate left characters
+      first = packed . Base (i - 1);
+      a = fbin;
+      b = rbin;
+      for (j = 0; j < 4 && ! bad_left; j ++)
+        if (packed . Is_Bad (i - 1) || unsigned (j) != first)
+          {
+            kmer_hash -> Set_First_Bits (a, j);
+            kmer_hash -> Set_Last_Bits (b, 3 - j);
+            p = Find_Mer (kmer_hash, a, b);
+            if (p != NULL)
+              fprintf (fp, "  %c,%c,%-5d", 'L', FWD_ACGT [j], p -> freq);
+          }
+
+      // Look for alternate right characters
+      last = packed . Base (i - 2 + Kmer_Len);
+      a = fbin;
+      b = rbin;
+      for (j = 0; j < 4 && ! bad_right; j ++)
+        if (packed . Is_Bad (i - 2 + Kmer_Len) || unsigned (j) != last)
+          {
+            kmer_hash -> Set_Last_Bits (a, j);
+            kmer_hash -> Set_First_Bits (b, 3 - j);
+            p = Find_Mer (kmer_hash, a, b);
+            if (p != NULL)
+              fprintf (fp, "  %c,%c,%-5d", 'R', FWD_ACGT [j], p -> freq);
+          }
+      fprintf (fp, "\n");
+
+      // Advance to next character
+      if (i + Kmer_Len <= seq_len)
+        {
+          last = packed . Base (i - 1 + Kmer_Len);
+          kmer_hash -> Fwd_Shift_In_Bits (fbin, last);
+          kmer_hash -> Rev_Shift_In_Bits (rbin, 3 - last);
+        }
+    }
+
+  return;
+}
+
+
 static void  Usage
   (void)
 
@@ -309,8 +355,9 @@ static void  Usage
     "USAGE:  multi-trace [options] <sequence-file> <kmer-counts>\n"
     "\n"
     "Read a list of kmers with counts, in the format produced\n"
-    "by 'jellyfish dump -c' from <kmer-counts>.  Then read a DNA\n"
-    "multi-fasta sequence file from <sequence-file> and print the\n"
+    "by 'jellyfish dump -c' from <kmer-counts>.  Then read DNA\n"
+    "multi-fasta or fastq sequences, which may be gzip-compressed, from\n"
+    "<sequence-file> and print the\n"
     "count of each kmer in the sequences.  Also check for and report\n"
     "any (k-1)mers in the sequence with an alternative preceding or\n"
     "trailing base from what is in the sequence and that have a count entry.\n"
@@ -321,6 +368,8 @@ static void  Usage
     "Options:\n"
     " -h\n"
     "    Print this message\n"
+    " -t <n>\n"
+    "    Trace sequences with <n> threads.  Output stays in input order\n"
     " -V <n>\n"
     "    Set verbose level to <n>; higher values for more debugging output\n"
     "\n");
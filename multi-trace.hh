@@ -15,6 +15,7 @@
 #include  "delcher.hh"
 #include  "fasta.hh"
 #include  "kmer-hash.hh"
+#include  "seq-pipeline.hh"
 
 
 const int  DEFAULT_HASH_PREFIX_CHARS = 10;
@@ -36,7 +37,9 @@ const int  KMER_INFO_FREQ_BITS = 15;
 struct Kmer_Info_t
 {
   unsigned  freq : KMER_INFO_FREQ_BITS;
-  unsigned  hit : 1;
+  unsigned char  hit;
+    // 1 if the kmer is in some traced sequence.  Its own byte, set
+    // atomically, since concurrent traces may set it.
 
   Kmer_Info_t ()
   {
@@ -48,13 +51,16 @@ struct Kmer_Info_t
 char  Complement
   (char ch);
 Kmer_Info_t  * Find_Mer
-  (Kmer_Hash_t <Kmer_Info_t> * kmer_hash, const char * fmer, const char * rmer);
+  (Kmer_Hash_t <Kmer_Info_t> * kmer_hash, const Binary_Mer_t & fbin,
+   const Binary_Mer_t & rbin);
 bool  Has_Positive_Hit
   (const Kmer_Info_t & info);
 static void  Parse_Command_Line
   (int argc, char * argv []);
 void  Reverse_Complement
   (char * s);
+static void  Trace_Sequence
+  (Seq_Record_t & r, FILE * fp, Kmer_Hash_t <Kmer_Info_t> * kmer_hash);
 static void  Usage
   (void);
 
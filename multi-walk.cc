@@ -20,21 +20,48 @@ extern int  Global_Debug_Flag;
 
 // Global variables
 
+int  Best_Paths = 0;
+  // If positive, set by -K option, output this many paths from each
+  // start with highest kmer coverage instead of depth-first walks
 bool  Complete_Strings = false;
   // If set true by -C option, then output complete path strings without
   // stopping when hit a previously used kmer
 char  Default_Walk_Dir = 'R';
   // Presumed direction of walk if not given explicitly
+const char  * End_Type = NULL;
+  // If not NULL, set by -e or -o option, only output walks whose
+  // explanation (e.g., Orf-end) begins with this
+bool  Gfa_Output = false;
+  // If set true by -G option, output the subgraph reachable from each
+  // start in GFA format instead of walk strings
 bool  Ignore_ORF = false;
   // If set true by -g option, pay no attention to open reading frames
+const char  * Cleaned_Kmer_Filename = NULL;
+  // Name of file to which to write the kmer counts left after cleaning,
+  // set by -W option
 const char  * Kmer_Count_Filename;
   // Name of file from which to read kmer counts
 int  Kmer_Len = -1;
   // Length of kmers
+int  Max_Bubble_Len = 0;
+  // Pop bubbles with weak branches of at most this many kmers before
+  // walking, set by -P option.  Zero means don't.
+int  Max_Tip_Len = 0;
+  // Clip weak tips of at most this many kmers before walking, set
+  // by -T option.  Zero means don't.
 unsigned  Max_Walks = UINT_MAX;
-  // Most walks from any start kmer, set by -x option
+  // Most walks from any start kmer in each direction, set by -x option
+bool  Mean_Coverage = false;
+  // If set true by -m option, rank -K paths by mean kmer count instead
+  // of least kmer count
+int  Min_Result_Len = 0;
+  // Only output walk strings at least this long, set by -l option.
+  // Branches that can't get this long are abandoned.
 int  Num_Steps = DEFAULT_NUM_STEPS;
   // Number of steps to take in walk
+int  Num_Threads = 1;
+  // Number of walks from different start kmers to do at once, set by
+  // -t option.  See Claim_Kmer for which walk gets a kmer both reach.
 char  * Start_Param;
   // Either name of file with starts or start kmer itself depending
   // on Start_On_Command_Line
@@ -44,6 +71,9 @@ const char  * Stop_Pattern_Filename = NULL;
   // Name of file containing stop patterns from -s option
 const char  * Used_Kmer_Filename = NULL;
   // Name of file to which to output used kmers from -u option
+bool  Use_Unitigs = false;
+  // If set true by -U option, compact the kmers into unitigs and walk
+  // through unitig interiors without hash lookups or per-step trace
 
 
 int  main
@@ -53,20 +83,21 @@ int  main
   FILE  * kmer_count_fp, * stop_pattern_fp;
   vector <char *>  start_kmer, walk_tag, stop_pattern;
   vector <char>  walk_dir;
-  std :: map <string, int>  result_mers;
-  unsigned  open_frame;
+  Unitig_Graph_t  * unitigs = NULL;
+  Stop_Set_t  stop_set;
   Kmer_Info_t  info;
-  char  fmer [MAX_LINE], rmer [MAX_LINE];
   char  a [MAX_LINE], b [MAX_LINE], s [MAX_LINE], line [MAX_LINE];
   char  wd;
   unsigned  max_count;
-  int  ct, num_open_frames;
-  int  i, j, k, n;
+  int  ct;
+  int  i, k, n;
 
   Verbose = 0;
 
   Parse_Command_Line (argc, argv);
 
+  Fasta_Buffer_Output (stdout);
+
   if (Stop_Pattern_Filename != NULL)
     {
       stop_pattern_fp = File_Open (Stop_Pattern_Filename, "r");
@@ -79,6 +110,7 @@ int  main
           for (i = 0; i < n; i ++)
             line [i] = toupper (line [i]);
 
+          stop_set . Add (line, stop_pattern . size ());
           stop_pattern . push_back (strdup (line));
         }
     }
@@ -123,7 +155,7 @@ int  main
                                Start_Param, line);
                       Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
                     }
-                  walk_dir . push_back (b [0]);
+                  walk_dir . push_back (wd);
                 }
               else
                 walk_dir . push_back (Default_Walk_Dir);
@@ -150,8 +182,9 @@ int  main
   Kmer_Hash_t <Kmer_Info_t>   Kmer_Hash (Kmer_Len, 11);
 
   max_count = (2 << KMER_INFO_FREQ_BITS) - 1;
-  printf ("max_count = %d\n", max_count);
-  info . used_fwd = info . used_rc = 0;
+  if (! Gfa_Output)
+    printf ("max_count = %d\n", max_count);
+  info . used = info . removed = 0;
 
   fprintf (stderr, "Reading kmer counts ...\n");
   i = 0;
@@ -178,518 +211,1171 @@ int  main
 #endif
     }
 
+  if (0 < Max_Tip_Len || 0 < Max_Bubble_Len)
+    {
+      Kmer_Cleaner_t <Kmer_Info_t>  cleaner (& Kmer_Hash, Kmer_Len);
+      long unsigned  tip_mers, bubble_mers;
+
+      fprintf (stderr, "Cleaning kmer graph ...\n");
+      cleaner . Clean (Max_Tip_Len, Max_Bubble_Len, tip_mers, bubble_mers);
+      fprintf (stderr, "Removed %s tip kmers", Commatize (tip_mers));
+      fprintf (stderr, " and %s bubble kmers\n", Commatize (bubble_mers));
+    }
+  if (Cleaned_Kmer_Filename != NULL)
+    {
+      FILE  * fp = File_Open (Cleaned_Kmer_Filename, "w");
+
+      Kmer_Hash . Dump_Kmers_Select (fp, & Print_If_Kept <Kmer_Info_t>, true);
+      fclose (fp);
+    }
+
+  if (Use_Unitigs)
+    {
+      unitigs = new Unitig_Graph_t;
+      fprintf (stderr, "Building unitigs ...\n");
+      Build_Unitigs (Kmer_Hash, * unitigs);
+      n = unitigs -> seq_start . size ();
+      fprintf (stderr, "%s unitigs", Commatize (n));
+      fprintf (stderr, " with %s kmers\n", Commatize (unitigs -> mer . size ()));
+    }
+
+  if (Gfa_Output)
+    printf ("H\tVN:Z:1.0\n");
+
   n = start_kmer . size ();
-  for (k = 0; k < n; k ++)
-    {
-      char  * result_string, * result_string_space = NULL;
-      vector <Stack_Entry_t>  walk_stack;
-      Stack_Entry_t  this_mer, next_mer [4];
-      Kmer_Info_t  * p;
-      string  result_s;
-      bool  backtrack, hit_stop_pattern = false, occurs_already;
-      char  dir;
-      const char  * s;
-      unsigned  variant;
-      int  result_lo, result_hi;
-      int  frame, num_found, pos, start_pos, step;
-      int  m, w, num_walks, extra, start_len;
-
-      if (walk_dir [k] == 'B')
-        {
-          dir = 'R';
-          num_walks = 2;
-        }
-      else
+  if (Num_Threads == 1)
+    for (k = 0; k < n; k ++)
+      Walk_From_Start (stdout, Kmer_Hash, unitigs, start_kmer [k], walk_tag [k],
+                       walk_dir [k], stop_pattern, & stop_set);
+  else
+    {
+      vector <std :: thread>  worker;
+      std :: atomic <int>  next;
+      Walk_Output_t  out;
+
+      next = 0;
+      out . buff . assign (n, NULL);
+      out . len . assign (n, 0);
+      out . next = 0;
+      for (i = 0; i < Num_Threads; i ++)
+        worker . push_back (std :: thread (Walk_Worker, & Kmer_Hash, unitigs,
+                                           & start_kmer, & walk_tag, & walk_dir,
+                                           & stop_pattern, & stop_set, & next,
+                                           & out));
+      for (i = 0; i < Num_Threads; i ++)
+        worker [i] . join ();
+    }
+
+  if (kmer_count_fp != stdin)
+    fclose (kmer_count_fp);
+
+  if (Used_Kmer_Filename != NULL)
+    {
+      FILE  * fp = File_Open (Used_Kmer_Filename, "w");
+
+      Kmer_Hash . Dump_Kmers_Select (fp, & Print_If_Used);
+    }
+
+  return  0;
+}
+
+
+void  Path_Set_t :: Clear
+  (void)
+
+// Remove all kmers from this set
+
+{
+  path . clear ();
+  table . assign (table . size (), -1);
+}
+
+
+const Path_Mer_t *  Path_Set_t :: Find
+  (const Kmer_Info_t * info, unsigned fwd_ori)
+
+// Return the entry for the kmer (or unitig) with hash entry info, in
+// orientation fwd_ori, on the path, or NULL if it's not there.
+
+{
+  int  i;
+
+  i = table [Probe (info, fwd_ori)];
+  if (i < 0)
+    return  NULL;
+
+  return  & path [i];
+}
+
+
+void  Path_Set_t :: Pop
+  (void)
+
+// Remove the most recently added kmer from this set
+
+{
+  const Path_Mer_t  & last = path . back ();
+
+  table [Probe (last . info, last . fwd_ori)] = -1;
+  path . pop_back ();
+}
+
+
+unsigned  Path_Set_t :: Probe
+  (const Kmer_Info_t * info, unsigned fwd_ori)
+
+// Return the subscript of the slot in table that holds the kmer with
+// hash entry info in orientation fwd_ori, or else of the empty slot
+// where it would go.
+
+{
+  uint64_t  h;
+  unsigned  i;
+
+  h = (uint64_t (info) >> 2) ^ fwd_ori;
+  h *= 0x9E3779B97F4A7C15ULL;
+
+  for (i = unsigned (h >> 32) & mask; 0 <= table [i]; i = (i + 1) & mask)
+    {
+      const Path_Mer_t  & q = path [table [i]];
+
+      if (q . info == info && q . fwd_ori == fwd_ori)
+        break;
+    }
+
+  return  i;
+}
+
+
+void  Path_Set_t :: Push
+  (const Kmer_Info_t * info, unsigned fwd_ori, int pos, int first, int len)
+
+// Add the kmer with hash entry info in orientation fwd_ori at position
+// pos to the end of the path.  For a run of len kmers of a unitig from
+// offset first, info is the unitig's first kmer and pos is the position
+// of the run's first kmer.  It must not already be in this set.
+
+{
+  Path_Mer_t  q;
+
+  if (table . size () < 2 * (path . size () + 1))
+    Rehash (2 * table . size ());
+
+  q . info = info;
+  q . fwd_ori = fwd_ori;
+  q . pos = pos;
+  q . first = first;
+  q . len = len;
+  table [Probe (info, fwd_ori)] = path . size ();
+  path . push_back (q);
+}
+
+
+void  Path_Set_t :: Rehash
+  (unsigned size)
+
+// Make table have size slots (which must be a power of 2) and
+// re-insert all the kmers on path into it.
+
+{
+  int  i, n;
+
+  table . assign (size, -1);
+  mask = size - 1;
+
+  n = path . size ();
+  for (i = 0; i < n; i ++)
+    table [Probe (path [i] . info, path [i] . fwd_ori)] = i;
+}
+
+
+int  Path_Tree_t :: Add
+  (const Best_Path_t & entry)
+
+// Add entry to this tree as a child of node entry . parent and
+// return its subscript.  Freed nodes are reused first.
+
+{
+  int  i;
+
+  if (free_node . empty ())
+    {
+      i = node . size ();
+      node . push_back (entry);
+    }
+  else
+    {
+      i = free_node . back ();
+      free_node . pop_back ();
+      node [i] = entry;
+    }
+  node [i] . live = 0;
+  node [i] . path_set = -1;
+  if (0 <= entry . parent)
+    node [entry . parent] . live ++;
+
+  return  i;
+}
+
+
+void  Path_Tree_t :: Clear
+  (void)
+
+// Remove all nodes from this tree
+
+{
+  node . clear ();
+  trie . clear ();
+  free_node . clear ();
+  free_trie . clear ();
+}
+
+
+void  Path_Tree_t :: Extend
+  (int i)
+
+// Make the trie of the kmers on the path to node i, i.e., its parent's
+// plus its own, before children are added to it.
+
+{
+  int  t;
+
+  t = (node [i] . parent < 0 ? -1 : node [node [i] . parent] . path_set);
+  t = Insert (t, i, Hash (node [i] . info, node [i] . fwd_ori), 0);
+  trie [t] . refs ++;
+  node [i] . path_set = t;
+}
+
+
+int  Path_Tree_t :: Find_Cycle
+  (int i)  const
+
+// Return the subscript of the node before node i on its path with the
+// same kmer in the same orientation, or -1 if there is none.
+
+{
+  uint64_t  h;
+  int  c, t, level;
+
+  if (node [i] . parent < 0)
+    return  -1;
+
+  h = Hash (node [i] . info, node [i] . fwd_ori);
+  t = node [node [i] . parent] . path_set;
+  for (level = 0; 0 <= t; level ++)
+    {
+      c = trie [t] . child [(h >> (64 - PATH_TRIE_BITS * (level + 1)))
+                              & ((1 << PATH_TRIE_BITS) - 1)];
+      if (c < -1)
         {
-          dir = walk_dir [k];
-          num_walks = 1;
+          c = -2 - c;
+          if (node [c] . info == node [i] . info
+                && node [c] . fwd_ori == node [i] . fwd_ori)
+            return  c;
+          return  -1;
         }
+      t = c;
+    }
 
-      a [Kmer_Len] = b [Kmer_Len] = '\0';
-      variant = 0;
+  return  -1;
+}
 
-      // Clear map of mers on result string;
-      result_mers . clear ();
 
-      for (w = 0; w < num_walks; w ++)
-        {
-          bool  fwd_ori;     // true iff kmer on walk is the canonical one
-                             //   in the hash
-          char  * last_mer;  // on the end of result_string
-          
-          printf ("\nWalk for  %s  dir= %c\n", walk_tag [k], dir);
-          printf ("%s  Start\n", start_kmer [k]);
+uint64_t  Path_Tree_t :: Hash
+  (const Kmer_Info_t * info, unsigned fwd_ori)  const
 
-          walk_stack . clear ();
+// Return the trie hash of the kmer with hash entry info in orientation
+// fwd_ori.  Entries are 4-byte aligned and multiplying by an odd
+// constant is one-to-one, so different kmers never get the same hash.
 
-          start_len = strlen (start_kmer [k]);
-          if (dir == 'R')
-            extra = start_len - Kmer_Len;
-              // in case start_kmer [k] is longer than Kmer_Len
-          else
-            extra = 0;
-          strncpy (fmer, start_kmer [k] + extra, Kmer_Len);
-          strncpy (rmer, start_kmer [k] + extra, Kmer_Len);
-          fmer [Kmer_Len] = rmer [Kmer_Len] = '\0';
-          Reverse_Complement (rmer);
+{
+  return  ((uint64_t (info) >> 1) | fwd_ori) * 0x9E3779B97F4A7C15ULL;
+}
 
-          if (w == 0)
-            {
-              result_string_space
-                = (char *) SAFE_REALLOC (result_string_space,
-                                         2 * Num_Steps + start_len + 3);
-              result_string = result_string_space + Num_Steps;
-              strcpy (result_string, start_kmer [k]);
-              result_lo = 0;
-              result_hi = start_len;
-                // Working result string is result_string [result_lo .. (result_hi - 1)]
-            }
 
-          // Use just the forward strand for open reading frames
-          open_frame = 0x7;  // All 3 frames open
-          pos = start_pos = start_len - 1;
-            // pos is the position of the rightmost base of fmer
-          if (dir == 'R')
-            frame = (pos + 1) % 3;
-          else
-            frame = 0;
-            // frame is 0, 1 or 2 determined by the position of the 1 base
-            // of the codon mod 3.  Going right the codon is the last 3bp
-            // of the fmer; going left, it is the first 3bp
-          num_open_frames = Set_Open_Frame (open_frame, start_kmer [k], pos);
+int  Path_Tree_t :: Insert
+  (int t, int sub, uint64_t h, int level)
 
-          if (0 < Verbose)
-            printf ("num_open_frames= %d  %c %c %c\n", num_open_frames,
-                    ((open_frame & 0x1) ? 'T' : 'F'),
-                    ((open_frame & 0x2) ? 'T' : 'F'),
-                    ((open_frame & 0x4) ? 'T' : 'F'));
+// Return a new trie node that is a copy of node t (or empty if t is -1)
+// at depth level with the kmer of tree node sub, whose hash is h,
+// added below it.  Node t itself is unchanged.
 
-          if (strcmp (fmer, rmer) < 0)
-            s = fmer;
-          else
-            s = rmer;
+{
+  int  c, j, k, n;
 
-          p = Kmer_Hash . Find (s);
-          if (p == NULL)
-            {
-              printf ("  Start kmer not found\n");
-              num_found = 0;
-            }
-          else
-            {
-              printf ("Start kmer freq= %d\n", p -> freq);
-              num_found = 1;
-              this_mer . pos = pos;
-              this_mer . r_lo = result_lo;
-              this_mer . r_hi = result_hi;
-              this_mer . freq = p -> freq;
-              this_mer . dir = dir;
-              this_mer . fmer = fmer;
-              this_mer . rmer = rmer;
-              this_mer . frame = frame;
-              this_mer . open_frame = open_frame;
-              walk_stack . push_back (this_mer);
-            }
-          
-          backtrack = false;
+  n = New_Trie_Node ();
+  k = (h >> (64 - PATH_TRIE_BITS * (level + 1))) & ((1 << PATH_TRIE_BITS) - 1);
+  if (0 <= t)
+    for (j = 0; j < (1 << PATH_TRIE_BITS); j ++)
+      {
+        c = trie [t] . child [j];
+        trie [n] . child [j] = c;
+        if (0 <= c && j != k)
+          trie [c] . refs ++;
+      }
 
-          while (! walk_stack . empty () && variant < Max_Walks)
-//          for (i = 0; i < Num_Steps && 0 < num_open_frames && 0 < num_found; i ++)
-            {
-              string  ms;
-              int  pattern_sub;
+  c = trie [n] . child [k];
+  if (c == -1)
+    c = -2 - sub;
+  else if (c < -1)
+    c = Split (-2 - c, Hash (node [-2 - c] . info, node [-2 - c] . fwd_ori),
+               sub, h, level + 1);
+  else
+    c = Insert (c, sub, h, level + 1);
+  if (0 <= c)
+    trie [c] . refs ++;
+  trie [n] . child [k] = c;
 
-              this_mer = walk_stack . back ();
-              walk_stack . pop_back ();
+  return  n;
+}
 
-              if (backtrack)
-                { // remove eliminated kmers from result_mers
-                  int  j;
 
-                  if (dir == 'R')
-                    {
-                      for (j = pos; this_mer . pos <= j; j --)
-                        {
-                          strncpy (a, result_string + j + 1 - Kmer_Len, Kmer_Len);
-                          ms = a;
-                          result_mers . erase (ms);
-                        }
-                    }
-                  else
-                    {
-                      for (j = pos; j <= this_mer . pos; j ++)
-                        {
-                          strncpy (a, result_string + j + 1 - Kmer_Len, Kmer_Len);
-                          ms = a;
-                          result_mers . erase (ms);
-                        }
-                    }
-                }
-              pos = this_mer . pos;
-              result_lo = this_mer . r_lo;
-              result_hi = this_mer . r_hi;
-              result_string [result_hi] = '\0';
-              frame = this_mer . frame;
-              open_frame = this_mer . open_frame;
-              num_open_frames = Num_Open (open_frame);
-              step = abs (pos - start_pos);
-
-              strcpy (fmer, this_mer . fmer . c_str ());
-              strcpy (rmer, this_mer . rmer . c_str ());
-
-              // Put correct end character on result string
-              // result_string is built from fmer's; rmer's are for hash lookups
-              if (dir == 'R')
-                {
-                  result_string [result_hi - 1] = fmer [Kmer_Len - 1];
-                  last_mer = fmer;
-                }
-              else
-                {
-                  result_string [result_lo] = fmer [0];
-                  last_mer = rmer;
-                }
+int  Path_Tree_t :: New_Trie_Node
+  (void)
 
-              if (strcmp (fmer, rmer) < 0)
-                {
-                  s = this_mer . fmer . c_str ();
-                  fwd_ori = true;
-                }
-              else
-                {
-                  s = this_mer . rmer . c_str ();
-                  fwd_ori = false;
-                }
-              p = Kmer_Hash . Find (s);
-              assert (p != NULL);
+// Return the subscript of an empty trie node with no references,
+// reusing a freed one if possible.
 
-              if (0 < Verbose)
-                {
-                  if (backtrack)
-                    printf ("\nBacktrack to fmer= %s\n", fmer);
-                  printf ("\nstep= %d  pos= %d  num_open_frames= %d  frame= %d\n"
-                          "  used_fwd/rc= %c/%c  backtrack= %c\n",
-                          step, pos, num_open_frames, frame,
-                          Bool_To_Char (p -> used_fwd),
-                          Bool_To_Char (p -> used_rc), Bool_To_Char (backtrack));
-                  printf ("result_lo/hi= %d/%d  hi_ch= %c\n", result_lo,
-                          result_hi, result_string [result_hi - 1]);
-                  if (1 < Verbose)
-                    printf ("fmer= %s  rmer= %s\n", fmer, rmer);
-                }
+{
+  int  j, t;
 
-              // Check already used first.  If so and backtracking then
-              // don't need to print anything.  But if not backtracking
-              // need to print
+  if (free_trie . empty ())
+    {
+      t = trie . size ();
+      trie . push_back (Path_Trie_Node_t ());
+    }
+  else
+    {
+      t = free_trie . back ();
+      free_trie . pop_back ();
+    }
+  for (j = 0; j < (1 << PATH_TRIE_BITS); j ++)
+    trie [t] . child [j] = -1;
+  trie [t] . refs = 0;
 
-              if (! Complete_Strings
-                  && ((fwd_ori && p -> used_fwd)
-                      || (! fwd_ori && p -> used_rc)))
-                {
-                  if (0 < Verbose)
-                    {
-                      printf ("  already used:  ");
-                      if (backtrack)
-                        printf ("backtracking--no need to print\n");
-                      else
-                        {
-                          printf ("not backtracking--print partial string\n");
-                          printf ("result_lo= %d  result_hi= %d\n", result_lo,
-                                  result_hi);
-                        }
-                    }
-                  if (! backtrack)
-                    Print_Result (stdout, result_string, result_lo, result_hi,
-                                  walk_tag [k], ++ variant, "Hit-used-kmer");
+  return  t;
+}
 
-                  backtrack = true;
-                  continue;
-                }
 
-              // See if at last step, or no open reading frames, or hit
-              // stop pattern.
-              // If so, do nothing and loop will pop next stack value;
-              // otherwise, continue.  Set a flag for which we're doing.
-
-              if (Stop_Pattern_Filename != NULL)
-                hit_stop_pattern = Check_Stops (stop_pattern, fmer, dir, pattern_sub);
-
-              // Check for cycles by seeing if last kmer occurs earlier
-              // on the path.  If so print and backtrack.
-              occurs_already
-                = (result_mers . find (this_mer . fmer) != result_mers . end ());
-              
-              if (step == Num_Steps || (num_open_frames == 0 && ! Ignore_ORF)
-                    || hit_stop_pattern || occurs_already)
-                {
-                  char  expl [MAX_LINE];
-
-                  if (hit_stop_pattern)
-                    sprintf (expl, "Hit-stop-pattern %s freq=%d",
-                             stop_pattern [pattern_sub], p -> freq);
-                  else if (num_open_frames == 0 && ! Ignore_ORF)
-                    sprintf (expl, "Orf-end freq=%d", p -> freq);
-                  else if (step == Num_Steps)
-                    sprintf (expl, "Max-steps freq=%d", p -> freq);
-                  else if (occurs_already)
-                    sprintf (expl, "Cycle-detected  pos= %d",
-                             result_mers [this_mer . fmer]);
-                  else
-                    {
-                      fprintf (stderr, "ERROR:  can't get here\n");
-                      exit (EXIT_FAILURE);
-                    }
-                      
-                  printf ("expl= %s\n", expl);
-                  printf ("result_lo= %d  result_hi= %d\n", result_lo,
-                          result_hi);
-                  Print_Result (stdout, result_string, result_lo, result_hi,
-                                walk_tag [k], ++ variant, expl);
-
-                  if (fwd_ori)
-                    p -> used_fwd = true;
-                  else
-                    p -> used_rc = true;
-                  backtrack = true;
-                  continue;
-                }
+void  Path_Tree_t :: Release
+  (int i)
 
-              // Add fmer to result_mers
-              result_mers [this_mer . fmer] = pos;
+// Free node i, which has no children, and then each ancestor that is
+// left with no children.  Their tries are released too.
 
-              if (fwd_ori)
-                p -> used_fwd = true;
-              else
-                p -> used_rc = true;
+{
+  int  j;
+
+  while (true)
+    {
+      if (0 <= node [i] . path_set)
+        Release_Trie (node [i] . path_set);
+      free_node . push_back (i);
+      j = node [i] . parent;
+      if (j < 0 || 0 < -- node [j] . live)
+        break;
+      i = j;
+    }
+}
+
+
+void  Path_Tree_t :: Release_Trie
+  (int t)
+
+// Drop one reference to trie node t and free it, and in turn its
+// children, when there are none left.
+
+{
+  int  c, j;
+
+  if (0 < -- trie [t] . refs)
+    return;
+
+  for (j = 0; j < (1 << PATH_TRIE_BITS); j ++)
+    {
+      c = trie [t] . child [j];
+      if (0 <= c)
+        Release_Trie (c);
+    }
+  free_trie . push_back (t);
+}
+
+
+int  Path_Tree_t :: Split
+  (int a, uint64_t ha, int b, uint64_t hb, int level)
+
+// Return a new trie node at depth level, with more below it as needed,
+// that holds the kmers of tree nodes a and b, whose hashes are ha and
+// hb.  The hashes must differ.
+
+{
+  int  c, ka, kb, n;
+
+  n = New_Trie_Node ();
+  ka = (ha >> (64 - PATH_TRIE_BITS * (level + 1))) & ((1 << PATH_TRIE_BITS) - 1);
+  kb = (hb >> (64 - PATH_TRIE_BITS * (level + 1))) & ((1 << PATH_TRIE_BITS) - 1);
+  if (ka != kb)
+    {
+      trie [n] . child [ka] = -2 - a;
+      trie [n] . child [kb] = -2 - b;
+    }
+  else
+    {
+      c = Split (a, ha, b, hb, level + 1);
+      trie [c] . refs ++;
+      trie [n] . child [ka] = c;
+    }
+
+  return  n;
+}
+
+
+const Unitig_Pos_t *  Unitig_Index_t :: Find
+  (const Kmer_Info_t * info)  const
+
+// Return the unitig position of the kmer with hash entry info, or NULL
+// if it has none.
+
+{
+  const Unitig_Pos_t  & q = table [Probe (info)];
+
+  return  (q . info == NULL ? NULL : & q);
+}
+
+
+unsigned  Unitig_Index_t :: Probe
+  (const Kmer_Info_t * info)  const
+
+// Return the subscript of the slot in table that holds the kmer with
+// hash entry info, or else of the empty slot where it would go.
+
+{
+  uint64_t  h;
+  unsigned  i;
+
+  h = uint64_t (info) >> 2;
+  h *= 0x9E3779B97F4A7C15ULL;
+
+  for (i = unsigned (h >> 32) & mask;
+         table [i] . info != NULL && table [i] . info != info;
+         i = (i + 1) & mask)
+    ;
+
+  return  i;
+}
+
+
+void  Unitig_Index_t :: Reserve
+  (size_t n)
+
+// Make this index empty with room for n kmers
+
+{
+  Unitig_Pos_t  empty;
+  size_t  size;
+
+  for (size = 1; size < 2 * n; size *= 2)
+    ;
+  empty . info = NULL;
+  empty . unitig = NO_UNITIG;
+  empty . offset = 0;
+  table . assign (size, empty);
+  mask = size - 1;
+}
+
+
+void  Unitig_Index_t :: Set
+  (const Kmer_Info_t * info, unsigned unitig, unsigned offset)
+
+// Set the unitig and offset of the kmer with hash entry info, adding
+// it if it's not in this index yet.  There must be room for it.
+
+{
+  Unitig_Pos_t  & q = table [Probe (info)];
+
+  q . info = info;
+  q . unitig = unitig;
+  q . offset = offset;
+}
+
+
+Stop_Set_t :: ~ Stop_Set_t
+  ()
+
+// Destroy this set of stop patterns
+
+{
+  int  i, n;
+
+  n = hash . size ();
+  for (i = 0; i < n; i ++)
+    delete hash [i];
+}
+
+
+void  Stop_Set_t :: Add
+  (const char * s, int sub)
+
+// Add pattern s, which is stop pattern number sub, to this set.
+// Walk kmers contain only ACGT, so patterns with any other character
+// can never match and are not stored.
+
+{
+  int  i, m, n;
+
+  m = strlen (s);
+  if (m == 0 || int (strspn (s, "ACGT")) != m)
+    return;
+
+  n = len . size ();
+  for (i = 0; i < n && len [i] != m; i ++)
+    ;
+  if (i == n)
+    {
+      len . push_back (m);
+      hash . push_back (new Kmer_Hash_t <int>
+                        (m, Max (STOP_HASH_PREFIX_CHARS, m - 64)));
+    }
+
+  hash [i] -> Find_Or_Insert (s, sub);
+}
+
+
+int  Stop_Set_t :: Find
+  (const char * fmer, char dir)
+
+// Return the subscript of the first stop pattern in this set that
+// is on the end of fmer corresponding to dir (the back for 'R', the
+// front for 'L'), or -1 if there is none.
+
+{
+  Binary_Mer_t  bin;
+  int  * p;
+  int  i, n, sub;
+
+  sub = -1;
+  n = len . size ();
+  for (i = 0; i < n; i ++)
+    {
+      if (Kmer_Len < len [i])
+        continue;
+      if (dir == 'R')
+        hash [i] -> Kmer_To_Binary (fmer + Kmer_Len - len [i], bin);
+      else
+        hash [i] -> Kmer_To_Binary (fmer, bin);
+      p = hash [i] -> Find (bin);
+      if (p != NULL && (sub < 0 || * p < sub))
+        sub = * p;
+    }
+
+  return  sub;
+}
+
+
+static void  Add_Graph_Edge
+  (vector <Graph_Node_t> & node, int from, int to)
+
+// Add an edge from node [from] to node [to] unless it's already there.
+
+{
+  int  i, n;
+
+  n = node [from] . succ . size ();
+  for (i = 0; i < n; i ++)
+    if (node [from] . succ [i] == to)
+      return;
+
+  node [from] . succ . push_back (to);
+  node [to] . in_degr ++;
+  node [to] . pred = from;
+
+  return;
+}
+
+
+static void  Best_Paths_From_Start
+  (FILE * fp, Kmer_Hash_t <Kmer_Info_t> & kmer_hash, const char * start,
+   const char * tag, char start_dir, vector <char *> & stop_pattern,
+   Stop_Set_t * stop_set)
+
+// Print to fp the Best_Paths complete paths from start in direction
+// start_dir ('R', 'L' or 'B' for both) with the highest least kmer
+// count (or mean kmer count if Mean_Coverage).  For 'B' each direction
+// is searched separately and gets its own Best_Paths paths.  Paths end
+// as walks do, at Num_Steps, an Orf-end, a stop pattern in stop_set, a
+// cycle or no extension.  Partial paths are kept in a tree and the one
+// with the best score is extended next; ties go to the one added last.  A path's least count can only
+// drop as it's extended, so the paths completed first are the best
+// ones and the search in a direction stops after Best_Paths of them.
+// Mean counts can rise, so for them this is only a greedy search.
+// Uses tag and stop_pattern to label output like Walk_From_Start.
+
+{
+  Path_Tree_t  tree;
+  priority_queue < pair <double, pair <int, int> > >  queue;
+  Best_Path_t  entry, next;
+  Kmer_Info_t  * p;
+  char  fmer [MAX_LINE], rmer [MAX_LINE], a [MAX_LINE], b [MAX_LINE];
+  char  expl [MAX_LINE];
+  char  * result_string, dir;
+  const char  * s;
+  unsigned  variant;
+  int  i, j, k, n, w, extra, num_found, pattern_sub, prev, seq, start_len;
+
+  start_len = strlen (start);
+  result_string = (char *) SAFE_MALLOC (start_len + Num_Steps + 2);
+  variant = 0;
+  a [Kmer_Len] = b [Kmer_Len] = '\0';
+
+  for (w = 0; w < 2; w ++)
+    {
+      dir = (w == 0 ? 'R' : 'L');
+      if (start_dir != 'B' && start_dir != dir)
+        continue;
+
+      fprintf (fp, "\nBest paths for  %s  dir= %c\n", tag, dir);
+      fprintf (fp, "%s  Start\n", start);
+
+      extra = (dir == 'R' ? start_len - Kmer_Len : 0);
+      strncpy (fmer, start + extra, Kmer_Len);
+      fmer [Kmer_Len] = '\0';
+      strcpy (rmer, fmer);
+      Reverse_Complement (rmer);
+      s = (strcmp (fmer, rmer) < 0 ? fmer : rmer);
+      p = kmer_hash . Find (s);
+      if (p == NULL)
+        {
+          fprintf (fp, "  Start kmer not found\n");
+          continue;
+        }
+
+      tree . Clear ();
+      while (! queue . empty ())
+        queue . pop ();
+      kmer_hash . Kmer_To_Binary (s, entry . mer);
+      entry . info = p;
+      entry . parent = -1;
+      entry . step = 0;
+      entry . min_freq = entry . sum_freq = p -> freq;
+      entry . fwd_ori = (s == fmer);
+      entry . frame = (dir == 'R' ? start_len % 3 : 0);
+      entry . open_frame = 0x7;
+      seq = 0;
+      queue . push (make_pair (double (p -> freq),
+                               make_pair (seq ++, tree . Add (entry))));
+
+      for (k = 0; k < Best_Paths && ! queue . empty (); )
+        {
+          i = queue . top () . second . second;
+          queue . pop ();
+          entry = tree [i];
+          Get_Walk_Mers (kmer_hash, entry . mer, entry . fwd_ori, fmer, rmer);
+
+          // Check for cycles by looking for this kmer, in the same
+          // orientation, earlier on the path
+          prev = tree . Find_Cycle (i);
+
+          pattern_sub = -1;
+          if (Stop_Pattern_Filename != NULL)
+            Check_Stops (stop_set, fmer, dir, pattern_sub);
+
+          expl [0] = '\0';
+          if (0 <= pattern_sub)
+            sprintf (expl, "Hit-stop-pattern %s", stop_pattern [pattern_sub]);
+          else if (entry . open_frame == 0 && ! Ignore_ORF)
+            strcpy (expl, "Orf-end");
+          else if (entry . step == Num_Steps)
+            strcpy (expl, "Max-steps");
+          else if (0 <= prev)
+            sprintf (expl, "Cycle-detected  pos= %d", tree [prev] . step);
+
+          num_found = 0;
+          if (expl [0] == '\0')
+            {
+              // Extend the path by each possible next kmer
+              tree . Extend (i);
               if (dir == 'R')
                 {
                   strncpy (a, fmer + 1, Kmer_Len - 1);
                   strncpy (b + 1, rmer, Kmer_Len - 1);
-                  pos ++;
-                  result_string [++ result_hi] = '\0';
-                  frame = (frame + 1) % 3;
+                  next . frame = (entry . frame + 1) % 3;
                 }
               else
                 {
                   strncpy (a + 1, fmer, Kmer_Len - 1);
                   strncpy (b, rmer + 1, Kmer_Len - 1);
-                  pos --;
-                  result_lo --;
-                  frame = (frame + 2) % 3;  // + 2 is the same as - 1 mod 3
+                  next . frame = (entry . frame + 2) % 3;
                 }
-
-              // consider all possibilites for the next letter
-              num_found = 0;
               for (j = 0; j < 4; j ++)
                 {
-                  unsigned  o_f;  // local copy of open_fram
-
-                  o_f = open_frame;
                   if (dir == 'R')
                     {
                       a [Kmer_Len - 1] = FWD_ACGT [j];
                       b [0] = REV_ACGT [j];
-                      if (Is_Stop (a + Kmer_Len - 3))
-                        o_f &= ~(0x1 << frame);
+                      next . open_frame = Close_Frame (entry . open_frame,
+                                 next . frame, Codon_Code (a + Kmer_Len - 3));
                     }
                   else
                     {
                       a [0] = FWD_ACGT [j];
                       b [Kmer_Len - 1] = REV_ACGT [j];
-                      if (Is_Stop (a))
-                        o_f &= ~(0x1 << frame);
-                    }
-                  if (strcmp (a, b) < 0)
-                    {
-                      s = a;
-                      fwd_ori = true;
+                      next . open_frame = Close_Frame (entry . open_frame,
+                                 next . frame, Codon_Code (a));
                     }
+                  next . fwd_ori = (strcmp (a, b) < 0);
+                  kmer_hash . Kmer_To_Binary (next . fwd_ori ? a : b, next . mer);
+                  p = kmer_hash . Find (next . mer);
+                  if (p == NULL || p -> removed)
+                    continue;
+
+                  next . info = p;
+                  next . parent = i;
+                  next . step = entry . step + 1;
+                  next . min_freq = Min (entry . min_freq, unsigned (p -> freq));
+                  next . sum_freq = entry . sum_freq + p -> freq;
+                  if (Mean_Coverage)
+                    queue . push (make_pair (double (next . sum_freq)
+                                               / (next . step + 1),
+                                             make_pair (seq ++, tree . Add (next))));
                   else
-                    {
-                      s = b;
-                      fwd_ori = false;
-                    }
-//                  printf ("\nj= %d  a= %s  b= %s\n", j, a, b);
-
-                  p = Kmer_Hash . Find (s);
-                  if (p == NULL)
-                    ;  // ignore
-                  else
-                    {
-//                      printf ("\nFound %s  ct= %d  pos= %d\n", s, p -> freq, pos);
-                      printf ("\nFound %s  ct= %d  pos= %d\n", a, p -> freq, pos);
-                      if ((fwd_ori && p -> used_fwd)
-                          || (! fwd_ori && p -> used_rc))
-                        printf ("  already used\n");
-
-                      // Include it even if it's already used.  Will detect
-                      // that when pop from the stack
-                      next_mer [num_found] . pos = pos;
-                      next_mer [num_found] . r_lo = result_lo;
-                      next_mer [num_found] . r_hi = result_hi;
-                      next_mer [num_found] . freq = p -> freq;
-                      next_mer [num_found] . dir = dir;
-                      next_mer [num_found] . fmer = a;
-                      next_mer [num_found] . rmer = b;
-                      next_mer [num_found] . frame = frame;
-                      next_mer [num_found] . open_frame = o_f;
-                      num_found ++;
-                    }
+                    queue . push (make_pair (double (next . min_freq),
+                                             make_pair (seq ++, tree . Add (next))));
+                  num_found ++;
                 }
-
-              printf ("num_found= %d", num_found);
-              if (num_found < 2)
-                  printf ("\n");
-              else
-                  printf ("  branch_pos= %d\n", result_hi - result_lo);
- 
-
               if (num_found == 0)
+                strcpy (expl, "No-extension");
+            }
+          if (0 < num_found)
+            continue;
+
+          // Path is complete.  Build its string from the tree, claiming
+          // its kmers for the -u option.  Paths that are filtered out
+          // by -e or -l don't count toward Best_Paths.  Then free its
+          // nodes that no other partial path needs.
+          n = entry . step;
+          if (! Keep_Result (start_len + n, expl))
+            {
+              tree . Release (i);
+              continue;
+            }
+          if (dir == 'R')
+            {
+              strcpy (result_string, start);
+              for (prev = i; 0 <= tree [prev] . parent; prev = tree [prev] . parent)
                 {
-                  printf ("No extension found--print partial orf\n"
-                          "  #open-frames= %d  pos= %d\n", num_open_frames, pos);
-                  // Set result_lo/hi back to previous value for printing
-                  if (dir ==  'R')
-                    result_hi --;
-                  else
-                    result_lo ++;
-                  Print_Result (stdout, result_string, result_lo, result_hi,
-                                walk_tag [k], ++ variant, "No-extension");
-                  backtrack = true;
+                  Get_Walk_Mers (kmer_hash, tree [prev] . mer,
+                                 tree [prev] . fwd_ori, a, b);
+                  result_string [start_len - 1 + tree [prev] . step]
+                    = a [Kmer_Len - 1];
                 }
-              else
+            }
+          else
+            {
+              strcpy (result_string + n, start);
+              for (prev = i; 0 <= tree [prev] . parent; prev = tree [prev] . parent)
                 {
-                  // sort entries by freq
-                  for (j = 0; j < num_found - 1; j ++)
-                    for (m = j + 1; m < num_found; m ++)
-                      if (next_mer [m] . freq < next_mer [j] . freq)
-                        {
-                          Stack_Entry_t  tmp = next_mer [j];
-
-                          next_mer [j] = next_mer [m];
-                          next_mer [m] = tmp;
-                        }
-
-                  // Push all possibilities onto stack
-                  for (j = 0; j < num_found; j ++)
-                    {
-                      if (1 < Verbose)
-                        printf ("push fmer= %s  freq= %d\n",
-                                next_mer [j] . fmer . c_str (),
-                                next_mer [j] . freq);
-                      walk_stack . push_back (next_mer [j]);
-                    }
-                  backtrack = false;
+                  Get_Walk_Mers (kmer_hash, tree [prev] . mer,
+                                 tree [prev] . fwd_ori, a, b);
+                  result_string [n - tree [prev] . step] = a [0];
                 }
             }
-          if (0 < Verbose)
-            printf ("\nWalk stack has %d entries\n", int (walk_stack . size ()));
-
-          dir = 'L';
+          for (prev = i; 0 <= prev; prev = tree [prev] . parent)
+            Claim_Kmer (tree [prev] . info, tree [prev] . fwd_ori);
+
+          sprintf (expl + strlen (expl), "  min_freq=%u  mean_freq=%.1f",
+                   entry . min_freq, double (entry . sum_freq) / (n + 1));
+          Print_Result (fp, result_string, 0, start_len + n, tag, ++ variant,
+                        expl);
+          tree . Release (i);
+          k ++;
         }
+    }
 
-#if 0
-      // print resulting string
-      printf ("\n");
-      for (j = result_lo; j < result_hi; j ++)
-        result_string [j] = toupper (result_string [j]);
-      Fasta_Print (stdout, result_string, walk_tag [k]);
-      printf ("\n");
-#endif
+  free (result_string);
 
-    }
+  return;
+}
 
-  if (kmer_count_fp != stdin)
-    fclose (kmer_count_fp);
 
-  if (Used_Kmer_Filename != NULL)
-    {
-      FILE  * fp = File_Open (Used_Kmer_Filename, "w");
+static void  Build_Unitigs
+  (Kmer_Hash_t <Kmer_Info_t> & kmer_hash, Unitig_Graph_t & unitigs)
 
-      Kmer_Hash . Dump_Kmers_Select (fp, & Print_If_Used);
-    }
+// Find the maximal non-branching paths of kmers in kmer_hash (ignoring
+// removed ones) and put them in unitigs, with the unitig and offset of
+// each kmer in unitigs . index .  A kmer whose only successor has other
+// predecessors, or vice versa, ends its unitig.
 
-  return  0;
+{
+  Kmer_Cleaner_t <Kmer_Info_t>  graph (& kmer_hash, Kmer_Len);
+  Binary_Mer_t  bin;
+  Kmer_Info_t  * p, * q;
+  const Unitig_Pos_t  * w;
+  char  fmer [MAX_LINE], rmer [MAX_LINE], next [MAX_LINE], ch [4];
+  unsigned  i, n, u;
+  int  j;
+
+  unitigs . index . Reserve (kmer_hash . Count_All ());
+
+  n = kmer_hash . Num_Prefixes ();
+  for (i = 0; i < n; i ++)
+    for (j = 0; (p = kmer_hash . Entry (i, j, bin)) != NULL; j ++)
+      {
+        if (p -> removed || unitigs . index . Find (p) != NULL)
+          continue;
+
+        // Back up to the start of the unitig, marking kmers with
+        // unitig u to stop on a cycle
+        u = unitigs . seq_start . size ();
+        kmer_hash . Binary_To_Kmer (bin, fmer, true);
+        unitigs . index . Set (p, u, UINT_MAX);
+        while (graph . Predecessors (fmer, ch) == 1)
+          {
+            next [0] = ch [0];
+            strncpy (next + 1, fmer, Kmer_Len - 1);
+            next [Kmer_Len] = '\0';
+            if (graph . Successors (next, ch) != 1)
+              break;
+            q = graph . Lookup (next);
+            if (unitigs . index . Find (q) != NULL)
+              break;
+            unitigs . index . Set (q, u, UINT_MAX);
+            strcpy (fmer, next);
+          }
+
+        // Now go forward adding kmers to the unitig
+        unitigs . seq_start . push_back (unitigs . seq . length ());
+        unitigs . first_mer . push_back (unitigs . mer . size ());
+        unitigs . seq . append (fmer);
+        while (true)
+          {
+            q = graph . Lookup (fmer);
+            strcpy (rmer, fmer);
+            Reverse_Complement (rmer);
+            unitigs . index . Set (q, u,
+                                   unitigs . mer . size () - unitigs . first_mer [u]);
+            unitigs . mer . push_back (q);
+            unitigs . fwd . push_back (strcmp (fmer, rmer) < 0);
+
+            if (graph . Successors (fmer, ch) != 1)
+              break;
+            strncpy (next, fmer + 1, Kmer_Len - 1);
+            next [Kmer_Len - 1] = ch [0];
+            next [Kmer_Len] = '\0';
+            if (graph . Predecessors (next, ch) != 1)
+              break;
+            q = graph . Lookup (next);
+            w = unitigs . index . Find (q);
+            if (w != NULL && (w -> unitig != u || w -> offset != UINT_MAX))
+              break;
+            unitigs . seq . push_back (next [Kmer_Len - 1]);
+            strcpy (fmer, next);
+          }
+      }
+  unitigs . first_mer . push_back (unitigs . mer . size ());
+
+  return;
 }
 
 
 static bool  Check_Stops
-  (vector <char *> & stop_pattern, char * fmer, char dir, int & pattern_sub)
+  (Stop_Set_t * stop_set, char * fmer, char dir, int & pattern_sub)
 
-// Check whether fmer contains any pattern in stop_pattern on the end
+// Check whether fmer contains any pattern in stop_set on the end
 // corresponding to dir.  If so, return true and set pattern_sub to the
 // subscript of the pattern; otherwise, return false and set pattern_sub
 // to -1.
 
-{
-  int  i, m, n, offset;
+{
+  pattern_sub = stop_set -> Find (fmer, dir);
+
+  return  (0 <= pattern_sub);
+}
+
+
+static bool  Claim_Kmer
+  (Kmer_Info_t * p, bool fwd_ori)
+
+// Mark the kmer with info p as used in orientation fwd_ori (true for
+// its canonical form).  Return true if this call is the one that set
+// it; false if it was already used.  The test and set is one atomic
+// operation, so when walks run concurrently (-t option) each kmer
+// orientation is owned by exactly one walk:  the first to claim it.
+// Any other walk reaching it later treats it as a previously used kmer.
+// Which of two concurrent walks gets there first can vary from run to
+// run, so use -t 1 (or -C, which doesn't stop at used kmers) when
+// exactly reproducible output is needed.
+
+{
+  unsigned char  bit = (fwd_ori ? USED_FWD : USED_RC);
+
+  return  ! (__atomic_fetch_or (& p -> used, bit, __ATOMIC_RELAXED) & bit);
+}
+
+
+char  Complement
+  (char ch)
+
+// Returns the DNA complement of  ch
+
+{
+  return  COMPLEMENT_TABLE [unsigned (ch)];
+}
+
+
+static void  Get_Walk_Mers
+  (Kmer_Hash_t <Kmer_Info_t> & kmer_hash, const Binary_Mer_t & mer,
+   bool fwd_ori, char * fmer, char * rmer)
+
+// Set fmer to the canonical kmer mer as it reads along the walk, i.e.,
+// itself if fwd_ori and else its reverse complement, and rmer to its
+// reverse complement.  Both must have room for Kmer_Len + 1 characters.
+
+{
+  if (fwd_ori)
+    {
+      kmer_hash . Binary_To_Kmer (mer, fmer, true);
+      strcpy (rmer, fmer);
+      Reverse_Complement (rmer);
+    }
+  else
+    {
+      kmer_hash . Binary_To_Kmer (mer, rmer, true);
+      strcpy (fmer, rmer);
+      Reverse_Complement (fmer);
+    }
+
+  return;
+}
+
+
+static void  Graph_From_Start
+  (FILE * fp, Kmer_Hash_t <Kmer_Info_t> & kmer_hash, const char * start,
+   const char * tag, char start_dir, Stop_Set_t * stop_set)
+
+// Find the kmers in kmer_hash that a walk from start in direction
+// start_dir ('R', 'L' or 'B' for both) could reach, i.e., within
+// Num_Steps steps and without going past an Orf-end or a stop pattern
+// in stop_set.  Print them to fp in GFA format, compacted into
+// segments named by tag and a number.  Each kmer is explored once for
+// each frame and set of open frames it's reached with, so the work is
+// proportional to the size of the subgraph rather than the number of
+// paths through it.  Used kmers are ignored.
+
+{
+  Kmer_Hash_t <int>  index (Kmer_Len, GRAPH_HASH_PREFIX_CHARS);
+  vector <Graph_Node_t>  node;
+  vector <Graph_State_t>  queue;
+  vector <int>  seg_last;
+  Graph_State_t  state, next;
+  char  mer [MAX_LINE], next_mer [MAX_LINE];
+  char  dir;
+  long unsigned  total;
+  unsigned  bit;
+  size_t  head;
+  int  frame, extra, start_len;
+  int  i, j, k, n, u, v, w;
+
+  start_len = strlen (start);
+  for (w = 0; w < 2; w ++)
+    {
+      dir = (w == 0 ? 'R' : 'L');
+      if (start_dir != 'B' && start_dir != dir)
+        continue;
+
+      // Same start kmer and frame as Walk_From_Start
+      extra = (dir == 'R' ? start_len - Kmer_Len : 0);
+      strncpy (mer, start + extra, Kmer_Len);
+      mer [Kmer_Len] = '\0';
+      state . node = Graph_Node (kmer_hash, index, node, mer);
+      if (state . node < 0)
+        {
+          fprintf (fp, "# %s  dir= %c  start kmer not found\n", tag, dir);
+          continue;
+        }
+      state . step = 0;
+      state . frame = (dir == 'R' ? start_len % 3 : 0);
+      state . open_frame = 0x7;
+
+      // Breadth-first search marking (node, frame, open_frame) states
+      // as seen when they're queued
+      queue . clear ();
+      queue . push_back (state);
+      node [state . node] . seen [w] |= 1 << (8 * state . frame + state . open_frame);
+      for (head = 0; head < queue . size (); head ++)
+        {
+          state = queue [head];
+          if (state . step == Num_Steps
+                || (state . open_frame == 0 && ! Ignore_ORF))
+            continue;
+          strcpy (mer, node [state . node] . mer . c_str ());
+          if (Stop_Pattern_Filename != NULL && 0 <= stop_set -> Find (mer, dir))
+            continue;
+
+          if (dir == 'R')
+            frame = (state . frame + 1) % 3;
+          else
+            frame = (state . frame + 2) % 3;
+          for (j = 0; j < 4; j ++)
+            {
+              if (dir == 'R')
+                {
+                  strcpy (next_mer, mer + 1);
+                  next_mer [Kmer_Len - 1] = FWD_ACGT [j];
+                  next_mer [Kmer_Len] = '\0';
+                }
+              else
+                {
+                  next_mer [0] = FWD_ACGT [j];
+                  strcpy (next_mer + 1, mer);
+                  next_mer [Kmer_Len] = '\0';
+                }
+              v = Graph_Node (kmer_hash, index, node, next_mer);
+              if (v < 0)
+                continue;
+              if (dir == 'R')
+                Add_Graph_Edge (node, state . node, v);
+              else
+                Add_Graph_Edge (node, v, state . node);
+
+              next . node = v;
+              next . step = state . step + 1;
+              next . frame = frame;
+              if (dir == 'R')
+                next . open_frame = Close_Frame (state . open_frame, frame,
+                                                 Codon_Code (next_mer + Kmer_Len - 3));
+              else
+                next . open_frame = Close_Frame (state . open_frame, frame,
+                                                 Codon_Code (next_mer));
+              bit = 1 << (8 * next . frame + next . open_frame);
+              if ((node [v] . seen [w] & bit) == 0)
+                {
+                  node [v] . seen [w] |= bit;
+                  queue . push_back (next);
+                }
+            }
+        }
+    }
 
-  n = stop_pattern . size ();
+  // Compact chains of nodes into segments.  A segment starts at any node
+  // that isn't the only successor of its only predecessor.  Nodes left
+  // after that are on cycles with no branches and are started anywhere.
+  n = node . size ();
+  for (k = 0; k < 2; k ++)
+    for (i = 0; i < n; i ++)
+      {
+        string  seq;
+
+        if (0 <= node [i] . seg)
+          continue;
+        u = node [i] . pred;
+        if (k == 0 && node [i] . in_degr == 1 && u != i
+              && node [u] . succ . size () == 1)
+          continue;
+
+        seq = node [i] . mer;
+        total = 0;
+        for (u = i; ; u = v)
+          {
+            node [u] . seg = seg_last . size ();
+            total += node [u] . freq;
+            if (node [u] . succ . size () != 1)
+              break;
+            v = node [u] . succ [0];
+            if (node [v] . in_degr != 1 || 0 <= node [v] . seg)
+              break;
+            seq . push_back (node [v] . mer [Kmer_Len - 1]);
+          }
+        fprintf (fp, "S\t%s.%d\t%s\tLN:i:%d\tKC:i:%lu\tkm:f:%.1f\n", tag,
+                     int (seg_last . size ()) + 1, seq . c_str (),
+                     int (seq . length ()), total,
+                     double (total) / (seq . length () - Kmer_Len + 1));
+        seg_last . push_back (u);
+      }
 
+  n = seg_last . size ();
   for (i = 0; i < n; i ++)
     {
-      m = strlen (stop_pattern [i]);
-      if (dir == 'R')
-        offset = Kmer_Len - m;
-      else
-        offset = 0;
-      if (strncmp (fmer + offset, stop_pattern [i], m) == 0)
-        {
-          pattern_sub = i;
-          return true;
-        }
+      u = seg_last [i];
+      k = node [u] . succ . size ();
+      for (j = 0; j < k; j ++)
+        fprintf (fp, "L\t%s.%d\t+\t%s.%d\t+\t%dM\n", tag, i + 1, tag,
+                     node [node [u] . succ [j]] . seg + 1, Kmer_Len - 1);
     }
 
-  pattern_sub = -1;
-  return false;
+  return;
 }
 
 
-char  Complement
-  (char ch)
+static int  Graph_Node
+  (Kmer_Hash_t <Kmer_Info_t> & kmer_hash, Kmer_Hash_t <int> & index,
+   vector <Graph_Node_t> & node, const char * mer)
 
-// Returns the DNA complement of  ch
+// Return the subscript in node of kmer mer, adding it to node and
+// index if it's new.  Return -1 if mer isn't in kmer_hash or was
+// removed.
 
 {
-  return  COMPLEMENT_TABLE [unsigned (ch)];
+  Graph_Node_t  new_node;
+  Kmer_Info_t  * p;
+  char  rmer [MAX_LINE];
+  int  * q;
+
+  q = index . Find (mer);
+  if (q != NULL)
+    return  * q;
+
+  strcpy (rmer, mer);
+  Reverse_Complement (rmer);
+  if (strcmp (mer, rmer) < 0)
+    p = kmer_hash . Find (mer);
+  else
+    p = kmer_hash . Find (rmer);
+  if (p == NULL || p -> removed)
+    return  -1;
+
+  new_node . mer = mer;
+  new_node . freq = p -> freq;
+  new_node . seen [0] = new_node . seen [1] = 0;
+  new_node . in_degr = 0;
+  new_node . pred = -1;
+  new_node . seg = -1;
+  index . Insert (mer, node . size ());
+  node . push_back (new_node);
+
+  return  node . size () - 1;
 }
 
 
-static bool  Is_Stop
-  (const char * codon)
+static bool  Is_Used
+  (const Kmer_Info_t & info, bool fwd_ori)
 
-// Return true iff the first 3 bases of codon are a stop codon
-// Assume all characters are uppercase
+// Return true iff the kmer with info has been used in orientation
+// fwd_ori (true for its canonical form).
 
 {
-  return (strncmp (codon, "TAA", 3) == 0
-          || strncmp (codon, "TAG", 3) == 0
-          || strncmp (codon, "TGA", 3) == 0);
+  unsigned char  bit = (fwd_ori ? USED_FWD : USED_RC);
+
+  return  (__atomic_load_n (& info . used, __ATOMIC_RELAXED) & bit);
 }
 
 
-static int  Num_Open
-  (unsigned char open_frame)
+static bool  Keep_Result
+  (int len, const char * expl)
 
-// Return the number of open reading frames in bit pattern open_fram
+// Return true iff a walk result of length len that ended for reason
+// expl should be output, i.e., it's at least Min_Result_Len long and,
+// if End_Type is set, expl begins with it.
 
 {
-  unsigned char  mask = 0x1;
-  int  i, n;
-
-  n = (mask & open_frame);
+  if (len < Min_Result_Len)
+    return  false;
+  if (End_Type != NULL && strncmp (expl, End_Type, strlen (End_Type)) != 0)
+    return  false;
 
-  for (i = 0; i < 2; i ++)
-    {
-      mask <<= 1;
-      n += ((mask & open_frame) ? 1 : 0);
-    }
-
-  return  n;
+  return  true;
 }
 
 
-
 static void  Parse_Command_Line
   (int argc, char * argv [])
 
@@ -703,7 +1389,7 @@ static void  Parse_Command_Line
   optarg = NULL;
 
   while  (! errflg
-          && ((ch = getopt (argc, argv, "bCghik:n:rs:u:V:x:")) != EOF))
+          && ((ch = getopt (argc, argv, "bCe:gGhik:K:l:mn:oP:rs:t:T:u:UV:W:x:")) != EOF))
     switch  (ch)
       {
       case  'b' :
@@ -714,10 +1400,18 @@ static void  Parse_Command_Line
         Complete_Strings = true;
         break;
 
+      case  'e' :
+        End_Type = optarg;
+        break;
+
       case  'g' :
         Ignore_ORF = true;
         break;
 
+      case  'G' :
+        Gfa_Output = true;
+        break;
+
       case  'h' :
         Usage ();
         exit (EXIT_SUCCESS);
@@ -730,10 +1424,30 @@ static void  Parse_Command_Line
         Kmer_Len = strtol (optarg, NULL, 10);
         break;
 
+      case  'K' :
+        Best_Paths = strtol (optarg, NULL, 10);
+        break;
+
+      case  'l' :
+        Min_Result_Len = strtol (optarg, NULL, 10);
+        break;
+
+      case  'm' :
+        Mean_Coverage = true;
+        break;
+
       case  'n' :
         Num_Steps = strtol (optarg, NULL, 10);
         break;
 
+      case  'o' :
+        End_Type = "Orf-end";
+        break;
+
+      case  'P' :
+        Max_Bubble_Len = strtol (optarg, NULL, 10);
+        break;
+
       case  'r' :
         Default_Walk_Dir = 'R';
         break;
@@ -742,14 +1456,36 @@ static void  Parse_Command_Line
         Stop_Pattern_Filename = optarg;
         break;
 
+      case  't' :
+        Num_Threads = strtol (optarg, NULL, 10);
+        if (Num_Threads < 1)
+          {
+            fprintf (stderr, "ERROR:  Bad -t option (threads) value %d\n",
+                     Num_Threads);
+            errflg = true;
+          }
+        break;
+
+      case  'T' :
+        Max_Tip_Len = strtol (optarg, NULL, 10);
+        break;
+
       case  'u' :
         Used_Kmer_Filename = optarg;
         break;
 
+      case  'U' :
+        Use_Unitigs = true;
+        break;
+
       case  'V' :
         Verbose = strtol (optarg, NULL, 10);
         break;
 
+      case  'W' :
+        Cleaned_Kmer_Filename = optarg;
+        break;
+
       case  'x' :
         Max_Walks = strtol (optarg, NULL, 10);
         break;
@@ -774,11 +1510,11 @@ static void  Parse_Command_Line
 void  Print_If_Used
   (FILE * fp, const char * s, const Kmer_Info_t & info)
 
-// Print string s and info . freq to fp if either info . used_fwd
-// or info . used_rc is true.
+// Print string s and info . freq to fp if the kmer has been used in
+// either orientation.
 
 {
-  if (info . used_fwd || info . used_rc)
+  if (info . used)
     fprintf (fp, "%s %6d\n", s, info . freq);
 
   return;
@@ -786,12 +1522,14 @@ void  Print_If_Used
 
 
 static void  Print_Result
-  (FILE * fp, char * s, int lo, int hi, char * id, unsigned ver, const char * expl)
+  (FILE * fp, char * s, int lo, int hi, const char * id, unsigned ver,
+   const char * expl, vector <size_t> * ver_pos)
 
 // Print to fp the contents of s from positions lo .. (hi - 1) in fasta
 // format.  Use id and the version number ver as the fasta-id and
-// also include expl on the fasta header line.  Note that this function
-// sets s [hi] to '\0';
+// also include expl on the fasta header line.  If ver_pos isn't NULL,
+// append to it the position in fp where ver is printed.  Note that
+// this function sets s [hi] to '\0';
 
 {
   char hdr [MAX_LINE];
@@ -799,6 +1537,8 @@ static void  Print_Result
   sprintf (hdr, "%s-%03u  %s", id, ver, expl);
   s [hi] = '\0';
   fprintf (fp, "\n");
+  if (ver_pos != NULL)
+    ver_pos -> push_back (ftell (fp) + 1 + strlen (id) + 1);
   Fasta_Print (fp, s + lo, hdr);
   fprintf (fp, "\n");
 
@@ -843,33 +1583,56 @@ static int  Set_Open_Frame
 // 0x4 for frame 2.  Or generally, (1 << f) for frame f
 
 {
-  char  codon [4];
-  int  f, i, k, n;
+  unsigned char  rev_open = 0;
+  int  f, n;
 
   // Reading frame 0 is when first base of codon is at position ..., -3, 0, 3, ...
   // Reading frame 1 is when first base of codon is at position ..., -2, 1, 4, ...
   // Reading frame 2 is when first base of codon is at position ..., -1, 2, 5, ...
 
   n = strlen (s);
-  f = (1 + offset - n);  // ref position of 1st base of s
+  f = (1 + offset - n) % 3;  // ref position of 1st base of s
   if (f < 0)
-    f += 3 * ((3 - f) % 3);  // get positive equivalent
-  f %= 3;
+    f += 3;  // get positive equivalent
+
+  Scan_Open_Frames (s, n, f, open_frame, rev_open);
+
+  return  NUM_OPEN_FRAMES [open_frame];
+}
 
-  codon [3] = '\0';
-  for (i = 0; i < n - 2; i ++)
-    {
-      strncpy (codon, s, 3);
-      if (Is_Stop (codon))
-        open_frame &= (~(0x1 << f));
-      f = (f + 1) % 3;
-    }
 
-  for (i = k = 0; i < 3; i ++)
-    if (open_frame & (0x1 << i))
-      k ++;
+static int  Unitig_Run
+  (const Unitig_Graph_t * unitigs, const Kmer_Info_t * p, bool fwd_ori,
+   char dir, unsigned & u, int & offset, bool & along)
 
-  return k;
+// If unitigs isn't NULL, set u and offset to the unitig in it that
+// contains the kmer with hash entry p and the kmer's position there,
+// and set along true iff a walk in direction dir that reads the kmer
+// in orientation fwd_ori goes through the unitig left to right.
+// Return the number of kmers of the unitig that follow p on the walk,
+// which is 0 if unitigs is NULL.
+
+{
+  const Unitig_Pos_t  * w;
+  int  n;
+
+  u = NO_UNITIG;
+  offset = 0;
+  along = true;
+  if (unitigs == NULL)
+    return  0;
+
+  w = unitigs -> index . Find (p);
+  assert (w != NULL);
+  u = w -> unitig;
+  offset = w -> offset;
+  n = unitigs -> first_mer [u + 1] - unitigs -> first_mer [u];
+
+  along = (fwd_ori == unitigs -> fwd [unitigs -> first_mer [u] + offset]);
+  if (dir == 'L')
+    along = ! along;
+
+  return  (along ? n - 1 - offset : offset);
 }
 
 
@@ -899,29 +1662,696 @@ static void  Usage
     " -C\n"
     "    Output complete path strings without stopping when a previously\n"
     "    used kmer is hit\n"
+    " -e <s>\n"
+    "    Only output walks whose explanation begins with <s>, e.g.,\n"
+    "    Orf-end or Hit-stop-pattern.  Others don't count toward -x\n"
     " -g\n"
     "    Ignore stop codons and walk through them\n"
+    " -G\n"
+    "    Instead of walk strings, output in GFA format the kmers that\n"
+    "    walks from each start could reach, compacted into segments with\n"
+    "    links, and with their total (KC) and mean (km) kmer counts\n"
     " -h\n"
     "    Print this message\n"
     " -i\n"
     "    <start-kmers> is the actual start kmer instead of a file\n"
     " -k <n>\n"
     "    Use kmer length <n> if <start-mers> has sequences longer than <n>\n"
+    " -K <n>\n"
+    "    Instead of depth-first walks, output the <n> complete paths in\n"
+    "    each direction from each start with the highest least kmer count,\n"
+    "    found best first, so a B start gets up to 2<n> paths.\n"
+    "    Used kmers are ignored as with -C\n"
+    " -l <n>\n"
+    "    Only output walk strings of at least <n> bases, and abandon\n"
+    "    branches that can't reach that length within the -n limit.\n"
+    "    Shorter strings don't count toward -x\n"
+    " -m\n"
+    "    With -K rank paths by mean kmer count instead.  The search is\n"
+    "    then greedy and the paths found may not be the exact best\n"
     " -n <n>\n"
     "    Walk for at most <n> steps\n"
+    " -o\n"
+    "    Only output walks that end at the end of an open reading frame.\n"
+    "    Same as  -e Orf-end\n"
+    " -P <n>\n"
+    "    Before walking, pop bubbles in the kmer graph by removing weak\n"
+    "    branches of at most <n> kmers\n"
     " -r\n"
     "    Walk in reverse direction.  Applies if -i option or no direction\n"
     "    is given in <start-kmers> file\n"
     " -s <f>\n"
     "    Read patterns from file <f> (one per line) and stop walk when\n"
     "    any pattern is hit\n"
+    " -t <n>\n"
+    "    Walk from <n> start kmers at once, and if <n> > 1 do the right\n"
+    "    and left walks of a 'B' start at the same time.  Output is still\n"
+    "    grouped by start in input order, but when walks share kmers\n"
+    "    which one reports Hit-used-kmer can vary between runs\n"
+    " -T <n>\n"
+    "    Before walking, remove weak tips of at most <n> kmers from the\n"
+    "    kmer graph\n"
     " -u <f>\n"
     "    Output all kmers used in walks to file <f>\n"
+    " -U\n"
+    "    Compact the kmers into unitigs and walk straight through their\n"
+    "    interiors.  Faster, and results are the same, but the per-step\n"
+    "    trace lines are only printed at branch points\n"
+    " -W <f>\n"
+    "    Write the kmer counts left after -P and -T cleaning to file <f>\n"
     " -x <n>\n"
-    "    Allow at most <n> walks from any start kmer\n"
+    "    Allow at most <n> walks from any start kmer in each direction,\n"
+    "    so a 'B' start can have up to 2<n>\n"
     "\n");
 
    return;
   }
 
 
+
+static void  Walk_From_Start
+  (FILE * fp, Kmer_Hash_t <Kmer_Info_t> & kmer_hash,
+   const Unitig_Graph_t * unitigs, const char * start, const char * tag,
+   char start_dir, vector <char *> & stop_pattern, Stop_Set_t * stop_set)
+
+// Do the walks through the kmers in kmer_hash from start, in direction
+// start_dir ('R', 'L' or 'B' for both).  Print the trace and the
+// resulting strings to fp, using tag as their id.  Walks stop at any
+// pattern in stop_set if the -s option was given; stop_pattern has
+// their text.  If unitigs isn't NULL, steps inside a unitig are taken
+// directly from it.  For the -G and -K options, print the reachable
+// subgraph or the best paths instead.
+
+{
+  FILE  * left_fp;
+  Kmer_Info_t  * p;
+  char  fmer [MAX_LINE], rmer [MAX_LINE];
+  char  * left_buff = NULL;
+  vector <size_t>  ver_pos;
+  size_t  left_len = 0, i, k, n;
+  unsigned  right_ct, left_ct;
+  bool  fwd_ori, start_claimed = false;
+
+  if (Gfa_Output)
+    {
+      Graph_From_Start (fp, kmer_hash, start, tag, start_dir, stop_set);
+      return;
+    }
+  if (0 < Best_Paths)
+    {
+      Best_Paths_From_Start (fp, kmer_hash, start, tag, start_dir,
+                             stop_pattern, stop_set);
+      return;
+    }
+
+  if (start_dir != 'B')
+    {
+      Walk_One_Dir (fp, kmer_hash, unitigs, start, tag, start_dir,
+                    stop_pattern, stop_set, false, right_ct, NULL);
+      return;
+    }
+
+  // When start is one kmer both walks begin with it.  Claim it here so
+  // neither walk finds it used by the other.
+  if (int (strlen (start)) == Kmer_Len)
+    {
+      strcpy (fmer, start);
+      strcpy (rmer, start);
+      Reverse_Complement (rmer);
+      fwd_ori = (strcmp (fmer, rmer) < 0);
+      p = kmer_hash . Find (fwd_ori ? fmer : rmer);
+      start_claimed = (p != NULL && Claim_Kmer (p, fwd_ori));
+    }
+
+  // The left and right walks of a 'B' start share no state, so do the
+  // left one into its own buffer, at the same time if -t allows.  Then
+  // append it after the right one, renumbering its results to follow.
+  left_fp = open_memstream (& left_buff, & left_len);
+  if (1 < Num_Threads)
+    {
+      std :: thread  left (Walk_One_Dir, left_fp, std :: ref (kmer_hash),
+                           unitigs, start, tag, 'L', std :: ref (stop_pattern),
+                           stop_set, start_claimed, std :: ref (left_ct),
+                           & ver_pos);
+
+      Walk_One_Dir (fp, kmer_hash, unitigs, start, tag, 'R', stop_pattern,
+                    stop_set, start_claimed, right_ct, NULL);
+      left . join ();
+    }
+  else
+    {
+      Walk_One_Dir (fp, kmer_hash, unitigs, start, tag, 'R', stop_pattern,
+                    stop_set, start_claimed, right_ct, NULL);
+      Walk_One_Dir (left_fp, kmer_hash, unitigs, start, tag, 'L',
+                    stop_pattern, stop_set, start_claimed, left_ct, & ver_pos);
+    }
+  fclose (left_fp);
+
+  n = ver_pos . size ();
+  for (i = k = 0; i < n; i ++)
+    {
+      fwrite (left_buff + k, 1, ver_pos [i] - k, fp);
+      fprintf (fp, "%03u", unsigned (right_ct + i + 1));
+      k = ver_pos [i] + snprintf (NULL, 0, "%03u", unsigned (i + 1));
+    }
+  fwrite (left_buff + k, 1, left_len - k, fp);
+  free (left_buff);
+
+  return;
+}
+
+
+static void  Walk_One_Dir
+  (FILE * fp, Kmer_Hash_t <Kmer_Info_t> & kmer_hash,
+   const Unitig_Graph_t * unitigs, const char * start, const char * tag,
+   char dir, vector <char *> & stop_pattern, Stop_Set_t * stop_set,
+   bool start_claimed, unsigned & variant, vector <size_t> * ver_pos)
+
+// Do the walks through the kmers in kmer_hash from start in direction
+// dir ('R' or 'L').  Print the trace and the resulting strings to fp,
+// using tag as their id, and set variant to the number of them.  If
+// ver_pos isn't NULL, append to it the position in fp of each result's
+// version number.  Walks stop at any pattern in stop_set if the -s
+// option was given; stop_pattern has their text.  If unitigs isn't
+// NULL, each unitig is walked through in one step.  If start_claimed,
+// the caller has already claimed the start kmer for this walk.
+
+{
+  Path_Set_t  result_mers;
+  char  fmer [MAX_LINE], rmer [MAX_LINE], a [MAX_LINE], b [MAX_LINE];
+  unsigned  open_frame;
+  int  j, num_open_frames;
+  char  * result_string, * result_string_space;
+  vector <Stack_Entry_t>  walk_stack;
+  Stack_Entry_t  this_mer, next_mer [4];
+  const Path_Mer_t  * prev;
+  const Kmer_Info_t  * run_key;
+  Kmer_Info_t  * p;
+  bool  claimed, stopped;
+  bool  backtrack, hit_stop_pattern = false, occurs_already;
+  bool  fwd_ori;     // true iff kmer on walk is the canonical one
+                     //   in the hash
+  bool  along;       // true iff the walk reads its unitig left to right
+  bool  same_ori;    // true iff the walk reads kmers as their unitig does
+  char  * last_mer;  // on the end of result_string
+  char  * walk_mer;  // the current kmer as read on the walk
+  char  ch;
+  const char  * s;
+  size_t  first, seq_lo;
+  unsigned  run_ori, u;
+  int  result_lo, result_hi;
+  int  frame, num_found, pos, start_pos, step;
+  int  cycle_at, offset, run_len, run_offset, run_pos, sign;
+  int  i, m, extra, start_len;
+
+  a [Kmer_Len] = b [Kmer_Len] = '\0';
+  variant = 0;
+
+  fprintf (fp, "\nWalk for  %s  dir= %c\n", tag, dir);
+  fprintf (fp, "%s  Start\n", start);
+
+  start_len = strlen (start);
+  if (dir == 'R')
+    extra = start_len - Kmer_Len;
+      // in case start is longer than Kmer_Len
+  else
+    extra = 0;
+  strncpy (fmer, start + extra, Kmer_Len);
+  strncpy (rmer, start + extra, Kmer_Len);
+  fmer [Kmer_Len] = rmer [Kmer_Len] = '\0';
+  Reverse_Complement (rmer);
+
+  result_string_space = (char *) SAFE_MALLOC (2 * Num_Steps + start_len + 3);
+  result_string = result_string_space + Num_Steps;
+  strcpy (result_string, start);
+  result_lo = 0;
+  result_hi = start_len;
+    // Working result string is result_string [result_lo .. (result_hi - 1)]
+
+  // Use just the forward strand for open reading frames
+  open_frame = 0x7;  // All 3 frames open
+  pos = start_pos = start_len - 1;
+    // pos is the position of the rightmost base of fmer
+  if (dir == 'R')
+    frame = (pos + 1) % 3;
+  else
+    frame = 0;
+    // frame is 0, 1 or 2 determined by the position of the 1 base
+    // of the codon mod 3.  Going right the codon is the last 3bp
+    // of the fmer; going left, it is the first 3bp
+  num_open_frames = Set_Open_Frame (open_frame, start, pos);
+
+  if (0 < Verbose)
+    fprintf (fp, "num_open_frames= %d  %c %c %c\n", num_open_frames,
+                 ((open_frame & 0x1) ? 'T' : 'F'),
+                 ((open_frame & 0x2) ? 'T' : 'F'),
+                 ((open_frame & 0x4) ? 'T' : 'F'));
+
+  if (strcmp (fmer, rmer) < 0)
+    s = fmer;
+  else
+    s = rmer;
+
+  p = kmer_hash . Find (s);
+  if (p == NULL)
+    {
+      fprintf (fp, "  Start kmer not found\n");
+      num_found = 0;
+    }
+  else
+    {
+      fprintf (fp, "Start kmer freq= %d\n", p -> freq);
+      num_found = 1;
+      kmer_hash . Kmer_To_Binary (s, this_mer . mer);
+      this_mer . fwd_ori = (s == fmer);
+      this_mer . pos = pos;
+      this_mer . r_lo = result_lo;
+      this_mer . r_hi = result_hi;
+      this_mer . freq = p -> freq;
+      this_mer . frame = frame;
+      this_mer . open_frame = open_frame;
+      walk_stack . push_back (this_mer);
+    }
+
+  backtrack = false;
+  sign = (dir == 'R' ? 1 : -1);
+
+  while (! walk_stack . empty () && variant < Max_Walks)
+//          for (i = 0; i < Num_Steps && 0 < num_open_frames && 0 < num_found; i ++)
+    {
+      int  pattern_sub, prev_pos;
+
+      this_mer = walk_stack . back ();
+      walk_stack . pop_back ();
+
+      if (backtrack)
+        { // remove eliminated kmers from result_mers
+          if (dir == 'R')
+            while (! result_mers . Empty ()
+                     && this_mer . pos <= result_mers . Top_Pos ())
+              result_mers . Pop ();
+          else
+            while (! result_mers . Empty ()
+                     && result_mers . Top_Pos () <= this_mer . pos)
+              result_mers . Pop ();
+        }
+      pos = this_mer . pos;
+      result_lo = this_mer . r_lo;
+      result_hi = this_mer . r_hi;
+      result_string [result_hi] = '\0';
+      frame = this_mer . frame;
+      open_frame = this_mer . open_frame;
+      num_open_frames = NUM_OPEN_FRAMES [open_frame];
+      step = abs (pos - start_pos);
+
+      Get_Walk_Mers (kmer_hash, this_mer . mer, this_mer . fwd_ori, fmer, rmer);
+
+      // Put correct end character on result string
+      // result_string is built from fmer's; rmer's are for hash lookups
+      if (dir == 'R')
+        {
+          result_string [result_hi - 1] = fmer [Kmer_Len - 1];
+          last_mer = fmer;
+        }
+      else
+        {
+          result_string [result_lo] = fmer [0];
+          last_mer = rmer;
+        }
+
+      fwd_ori = this_mer . fwd_ori;
+      p = kmer_hash . Find (this_mer . mer);
+      assert (p != NULL);
+
+      if (0 < Verbose)
+        {
+          if (backtrack)
+            fprintf (fp, "\nBacktrack to fmer= %s\n", fmer);
+          fprintf (fp, "\nstep= %d  pos= %d  num_open_frames= %d  frame= %d\n"
+                       "  used_fwd/rc= %c/%c  backtrack= %c\n",
+                       step, pos, num_open_frames, frame,
+                       Bool_To_Char (Is_Used (* p, true)),
+                       Bool_To_Char (Is_Used (* p, false)),
+                       Bool_To_Char (backtrack));
+          fprintf (fp, "result_lo/hi= %d/%d  hi_ch= %c\n", result_lo,
+                       result_hi, result_string [result_hi - 1]);
+          if (1 < Verbose)
+            fprintf (fp, "fmer= %s  rmer= %s\n", fmer, rmer);
+        }
+
+      // Abandon this branch if nothing it leads to can be output.
+      // The result is just the start plus this walk's bases, and it
+      // grows by one base a step in either direction, so it can get
+      // at most Num_Steps - step bases longer.
+      if (result_hi - result_lo + Num_Steps - step < Min_Result_Len)
+        {
+          if (0 < Verbose)
+            fprintf (fp, "  can't reach min length %d\n", Min_Result_Len);
+          backtrack = true;
+          continue;
+        }
+
+      // With unitigs, the walk goes through the rest of this kmer's
+      // unitig in one pass over its sequence, with no hash lookups or
+      // stack entries, and puts the run of kmers on result_mers as one
+      // entry.  Otherwise a run is just this kmer.
+      run_len = 1 + Unitig_Run (unitigs, p, fwd_ori, dir, u, offset, along);
+      if (unitigs == NULL)
+        {
+          run_key = p;
+          run_ori = fwd_ori;
+        }
+      else
+        {
+          first = unitigs -> first_mer [u];
+          seq_lo = unitigs -> seq_start [u];
+          run_key = unitigs -> mer [first];
+          run_ori = along;
+          same_ori = (fwd_ori == unitigs -> fwd [first + offset]);
+          if (0 < Verbose && 1 < run_len)
+            fprintf (fp, "unitig run of %d kmers\n", run_len);
+        }
+      run_offset = offset;
+      run_pos = pos;
+
+      // Check for cycles by seeing if any kmer of the run occurs
+      // earlier on the path.  An earlier run of the same unitig read
+      // the same way covers a range of offsets, and this run can only
+      // reach it at the offset nearest to this one.
+      cycle_at = -1;
+      prev = result_mers . Find (run_key, run_ori);
+      if (prev != NULL)
+        {
+          if (along && offset < prev -> first + prev -> len)
+            {
+              cycle_at = Max (0, prev -> first - offset);
+              prev_pos = prev -> pos + sign * (offset + cycle_at - prev -> first);
+            }
+          else if (! along && prev -> first - prev -> len < offset)
+            {
+              cycle_at = Max (0, offset - prev -> first);
+              prev_pos = prev -> pos + sign * (prev -> first - offset + cycle_at);
+            }
+        }
+
+      stopped = false;
+      for (i = 0; ; i ++)
+        {
+          if (0 < i)
+            {
+              // Step to the next kmer of the unitig
+              offset += (along ? 1 : -1);
+              p = unitigs -> mer [first + offset];
+              fwd_ori = (same_ori == unitigs -> fwd [first + offset]);
+              ch = unitigs -> seq [seq_lo + offset + (along ? Kmer_Len - 1 : 0)];
+              if ((dir == 'R') != along)
+                ch = Complement (ch);
+              step ++;
+              if (dir == 'R')
+                {
+                  pos ++;
+                  result_string [result_hi ++] = ch;
+                  result_string [result_hi] = '\0';
+                  frame = (frame + 1) % 3;
+                  open_frame = Close_Frame (open_frame, frame,
+                                            Codon_Code (result_string + result_hi - 3));
+                }
+              else
+                {
+                  pos --;
+                  result_string [-- result_lo] = ch;
+                  frame = (frame + 2) % 3;
+                  open_frame = Close_Frame (open_frame, frame,
+                                            Codon_Code (result_string + result_lo));
+                }
+              num_open_frames = NUM_OPEN_FRAMES [open_frame];
+            }
+          walk_mer = (dir == 'R' ? result_string + result_hi - Kmer_Len
+                                 : result_string + result_lo);
+
+          // Claim this kmer for this walk.  If it was already used
+          // (by this or any other walk) then stop here.  If
+          // backtracking then don't need to print anything.  But if not
+          // backtracking need to print
+
+          if (step == 0 && start_claimed)
+            claimed = true;
+          else
+            claimed = Claim_Kmer (p, fwd_ori);
+          if (! Complete_Strings && ! claimed)
+            {
+              if (0 < Verbose)
+                {
+                  fprintf (fp, "  already used:  ");
+                  if (backtrack && i == 0)
+                    fprintf (fp, "backtracking--no need to print\n");
+                  else
+                    {
+                      fprintf (fp, "not backtracking--print partial string\n");
+                      fprintf (fp, "result_lo= %d  result_hi= %d\n", result_lo,
+                                   result_hi);
+                    }
+                }
+              if ((! backtrack || 0 < i)
+                    && Keep_Result (result_hi - result_lo, "Hit-used-kmer"))
+                Print_Result (fp, result_string, result_lo, result_hi,
+                              tag, ++ variant, "Hit-used-kmer", ver_pos);
+
+              stopped = true;
+              break;
+            }
+
+          // See if at last step, or no open reading frames, or hit
+          // stop pattern, or a cycle.
+          // If so, print and the loop will pop the next stack value;
+          // otherwise, continue.  Set a flag for which we're doing.
+
+          if (Stop_Pattern_Filename != NULL)
+            hit_stop_pattern = Check_Stops (stop_set, walk_mer, dir, pattern_sub);
+          occurs_already = (i == cycle_at);
+
+          if (step == Num_Steps || (num_open_frames == 0 && ! Ignore_ORF)
+                || hit_stop_pattern || occurs_already)
+            {
+              char  expl [MAX_LINE];
+
+              if (hit_stop_pattern)
+                sprintf (expl, "Hit-stop-pattern %s freq=%d",
+                         stop_pattern [pattern_sub], p -> freq);
+              else if (num_open_frames == 0 && ! Ignore_ORF)
+                sprintf (expl, "Orf-end freq=%d", p -> freq);
+              else if (step == Num_Steps)
+                sprintf (expl, "Max-steps freq=%d", p -> freq);
+              else if (occurs_already)
+                sprintf (expl, "Cycle-detected  pos= %d", prev_pos);
+              else
+                {
+                  fprintf (stderr, "ERROR:  can't get here\n");
+                  exit (EXIT_FAILURE);
+                }
+
+              fprintf (fp, "expl= %s\n", expl);
+              fprintf (fp, "result_lo= %d  result_hi= %d\n", result_lo,
+                           result_hi);
+              if (Keep_Result (result_hi - result_lo, expl))
+                Print_Result (fp, result_string, result_lo, result_hi,
+                              tag, ++ variant, expl, ver_pos);
+
+              stopped = true;
+              break;
+            }
+
+          if (i == run_len - 1)
+            break;
+        }
+      if (stopped)
+        {
+          backtrack = true;
+          continue;
+        }
+
+      // Add the run to result_mers
+      result_mers . Push (run_key, run_ori, run_pos, run_offset, run_len);
+      if (1 < run_len)
+        {
+          strncpy (fmer, walk_mer, Kmer_Len);
+          strcpy (rmer, fmer);
+          Reverse_Complement (rmer);
+        }
+
+      if (dir == 'R')
+        {
+          strncpy (a, fmer + 1, Kmer_Len - 1);
+          strncpy (b + 1, rmer, Kmer_Len - 1);
+          pos ++;
+          result_string [++ result_hi] = '\0';
+          frame = (frame + 1) % 3;
+        }
+      else
+        {
+          strncpy (a + 1, fmer, Kmer_Len - 1);
+          strncpy (b, rmer + 1, Kmer_Len - 1);
+          pos --;
+          result_lo --;
+          frame = (frame + 2) % 3;  // + 2 is the same as - 1 mod 3
+        }
+
+      // consider all possibilites for the next letter
+      num_found = 0;
+      for (j = 0; j < 4; j ++)
+        {
+          unsigned  o_f;  // local copy of open_fram
+
+          o_f = open_frame;
+          if (dir == 'R')
+            {
+              a [Kmer_Len - 1] = FWD_ACGT [j];
+              b [0] = REV_ACGT [j];
+              o_f = Close_Frame (o_f, frame, Codon_Code (a + Kmer_Len - 3));
+            }
+          else
+            {
+              a [0] = FWD_ACGT [j];
+              b [Kmer_Len - 1] = REV_ACGT [j];
+              o_f = Close_Frame (o_f, frame, Codon_Code (a));
+            }
+          if (strcmp (a, b) < 0)
+            {
+              s = a;
+              fwd_ori = true;
+            }
+          else
+            {
+              s = b;
+              fwd_ori = false;
+            }
+//                  printf ("\nj= %d  a= %s  b= %s\n", j, a, b);
+
+          kmer_hash . Kmer_To_Binary (s, next_mer [num_found] . mer);
+          p = kmer_hash . Find (next_mer [num_found] . mer);
+          if (p == NULL || p -> removed)
+            ;  // ignore
+          else
+            {
+//                      printf ("\nFound %s  ct= %d  pos= %d\n", s, p -> freq, pos);
+              fprintf (fp, "\nFound %s  ct= %d  pos= %d\n", a, p -> freq, pos);
+              if (Is_Used (* p, fwd_ori))
+                fprintf (fp, "  already used\n");
+
+              // Include it even if it's already used.  Will detect
+              // that when pop from the stack
+              next_mer [num_found] . fwd_ori = fwd_ori;
+              next_mer [num_found] . pos = pos;
+              next_mer [num_found] . r_lo = result_lo;
+              next_mer [num_found] . r_hi = result_hi;
+              next_mer [num_found] . freq = p -> freq;
+              next_mer [num_found] . frame = frame;
+              next_mer [num_found] . open_frame = o_f;
+              num_found ++;
+            }
+        }
+
+      fprintf (fp, "num_found= %d", num_found);
+      if (num_found < 2)
+          fprintf (fp, "\n");
+      else
+          fprintf (fp, "  branch_pos= %d\n", result_hi - result_lo);
+
+
+      if (num_found == 0)
+        {
+          fprintf (fp, "No extension found--print partial orf\n"
+                       "  #open-frames= %d  pos= %d\n", num_open_frames, pos);
+          // Set result_lo/hi back to previous value for printing
+          if (dir ==  'R')
+            result_hi --;
+          else
+            result_lo ++;
+          if (Keep_Result (result_hi - result_lo, "No-extension"))
+            Print_Result (fp, result_string, result_lo, result_hi,
+                          tag, ++ variant, "No-extension", ver_pos);
+          backtrack = true;
+        }
+      else
+        {
+          // sort entries by freq
+          for (j = 0; j < num_found - 1; j ++)
+            for (m = j + 1; m < num_found; m ++)
+              if (next_mer [m] . freq < next_mer [j] . freq)
+                {
+                  Stack_Entry_t  tmp = next_mer [j];
+
+                  next_mer [j] = next_mer [m];
+                  next_mer [m] = tmp;
+                }
+
+          // Push all possibilities onto stack
+          for (j = 0; j < num_found; j ++)
+            {
+              if (1 < Verbose)
+                {
+                  Get_Walk_Mers (kmer_hash, next_mer [j] . mer,
+                                 next_mer [j] . fwd_ori, a, b);
+                  fprintf (fp, "push fmer= %s  freq= %d\n", a,
+                               int (next_mer [j] . freq));
+                }
+              walk_stack . push_back (next_mer [j]);
+            }
+          backtrack = false;
+        }
+    }
+  if (0 < Verbose)
+    fprintf (fp, "\nWalk stack has %d entries\n", int (walk_stack . size ()));
+
+  free (result_string_space);
+
+  return;
+}
+
+
+static void  Walk_Worker
+  (Kmer_Hash_t <Kmer_Info_t> * kmer_hash, const Unitig_Graph_t * unitigs,
+   vector <char *> * start_kmer, vector <char *> * walk_tag,
+   vector <char> * walk_dir, vector <char *> * stop_pattern,
+   Stop_Set_t * stop_set, std :: atomic <int> * next, Walk_Output_t * out)
+
+// Thread to do walks for the -t option.  Repeatedly claim the next
+// unwalked start by incrementing next, do its walks with output to a
+// memory buffer, and then put the buffer in out.  Whichever thread
+// completes the earliest unprinted start prints it and any completed
+// starts after it, so output is in start order.
+
+{
+  FILE  * fp;
+  char  * buff;
+  size_t  len;
+  int  k, n;
+
+  n = start_kmer -> size ();
+  while ((k = (* next) ++) < n)
+    {
+      fp = open_memstream (& buff, & len);
+      if (fp == NULL)
+        {
+          sprintf (Clean_Exit_Msg_Line, "ERROR:  Can't open output buffer");
+          Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+        }
+      Walk_From_Start (fp, * kmer_hash, unitigs, (* start_kmer) [k],
+                       (* walk_tag) [k], (* walk_dir) [k], * stop_pattern,
+                       stop_set);
+      fclose (fp);
+
+      std :: lock_guard <std :: mutex>  guard (out -> lock);
+
+      out -> buff [k] = buff;
+      out -> len [k] = len;
+      while (out -> next < n && out -> buff [out -> next] != NULL)
+        {
+          fwrite (out -> buff [out -> next], 1, out -> len [out -> next], stdout);
+          free (out -> buff [out -> next]);
+          out -> next ++;
+        }
+    }
+
+  return;
+}
@@ -15,15 +15,34 @@
 #include  "delcher.hh"
 #include  "fasta.hh"
 #include  "kmer-hash.hh"
+#include  "kmer-clean.hh"
+#include  "codon.hh"
+
+#include  <atomic>
+#include  <functional>
+#include  <mutex>
+#include  <thread>
 
 
 const int  DEFAULT_NUM_STEPS = 200;
   // Default number of steps to take in walk
+const int  GRAPH_HASH_PREFIX_CHARS = 8;
+  // Prefix length of the hash of kmers in the subgraph explored for -G.
+  // Much smaller than the main hash so it's cheap to create for each start.
+const int  INITIAL_PATH_TABLE = 1024;
+  // Initial number of slots in the hash table of kmers on the current
+  // walk path.  Must be a power of 2.
 const int  MAX_LINE = 1000;
   // Max length of input lines/strings
 const int  MIN_OLAP = 5;
   // A match overlapping another by this much or more on both strings
   // is discarded
+const int  PATH_TRIE_BITS = 4;
+  // Hash bits used at each level of the trie of kmers on a -K path,
+  // so each trie node has (1 << PATH_TRIE_BITS) children
+const int  STOP_HASH_PREFIX_CHARS = 8;
+  // Prefix length of the hashes of stop patterns.  Much smaller than
+  // the main hash since there's one for each pattern length.
 
 static const char  COMPLEMENT_TABLE []
   = "nnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnn"
@@ -35,17 +54,26 @@ static const char  REV_ACGT [] = "TGCA";
 
 
 const int  KMER_INFO_FREQ_BITS = 14;
+const unsigned  NO_UNITIG = UINT_MAX;
+  // Unitig subscript of kmers not in any unitig
+const unsigned char  USED_FWD = 0x1;
+  // Bit in Kmer_Info_t used if this version of kmer is used
+const unsigned char  USED_RC = 0x2;
+  // Bit in Kmer_Info_t used if reverse complement of kmer is used
 
 struct Kmer_Info_t
 {
   unsigned  freq : KMER_INFO_FREQ_BITS;
-  unsigned  used_fwd : 1;    // true if this version of kmer is used
-  unsigned  used_rc : 1;     // true if reverse complement of kmer is used
+  unsigned  removed : 1;     // true if removed as an error tip or bubble
+  unsigned char  used;
+    // USED_FWD and USED_RC bits.  Only accessed by Claim_Kmer and Is_Used
+    // since concurrent walks may set it.
 
   Kmer_Info_t ()
   {
     freq = 0;
-    used_fwd = used_rc = 0;
+    removed = 0;
+    used = 0;
   }
 };
 
@@ -57,16 +85,270 @@ struct Result_Hash_Entry_t
 
 struct Stack_Entry_t
 {
-  int  pos, freq;
+  Binary_Mer_t  mer;
+    // the kmer in its canonical (hash) form
+  int  pos;
   int  r_lo, r_hi;  // give active portion of result_string
-  int  frame;
-  char  dir;
-  string  fmer, rmer;
-  unsigned char  open_frame;
+  unsigned  freq : KMER_INFO_FREQ_BITS;
+  unsigned  fwd_ori : 1;
+    // true iff the kmer on the walk (fmer) is the canonical one
+  unsigned  frame : 2;
+  unsigned  open_frame : 3;
     // Use 1 bit for each frame: 0x1 for frame 0; 0x2 for frame 1; 0x4 for frame 2
     // so, in general, (1 << f) for frame f
 };
 
+struct Best_Path_t
+{
+  // Node of the tree of partial paths searched for the -K option.
+  // A path is its last node and the chain of parents back to the start.
+  Binary_Mer_t  mer;
+    // the kmer in its canonical (hash) form
+  Kmer_Info_t  * info;
+    // its hash entry
+  int  parent;
+    // subscript of the previous kmer's node, -1 for the start
+  int  live;
+    // number of children of this node not yet freed
+  int  path_set;
+    // root in the trie pool of the kmers on the path to here, -1 if
+    // none has been made yet
+  int  step;
+  unsigned  min_freq;
+    // least kmer count on the path
+  long unsigned  sum_freq;
+    // total of the kmer counts on the path
+  unsigned  fwd_ori : 1;
+    // true iff the kmer on the walk (fmer) is the canonical one
+  unsigned  frame : 2;
+  unsigned  open_frame : 3;
+};
+
+struct Path_Trie_Node_t
+{
+  // Node of the persistent hash trie of kmers on -K paths
+  int  child [1 << PATH_TRIE_BITS];
+    // -1 if empty, (-2 - i) for the kmer of tree node i, otherwise
+    // the subscript of the next trie node
+  int  refs;
+    // number of trie and tree nodes that point to this one
+};
+
+class Path_Tree_t
+{
+  // The tree of partial paths searched for the -K option.  Each node
+  // that is extended gets a persistent hash trie of the kmers on its
+  // path, which shares all but one branch with its parent's, so a
+  // cycle is found with one lookup instead of a walk back to the start.
+  // Nodes whose subtrees are finished are freed and reused.
+private:
+  vector <Best_Path_t>  node;
+  vector <Path_Trie_Node_t>  trie;
+  vector <int>  free_node, free_trie;
+
+  uint64_t  Hash
+    (const Kmer_Info_t * info, unsigned fwd_ori)  const;
+  int  Insert
+    (int t, int sub, uint64_t h, int level);
+  int  New_Trie_Node
+    (void);
+  void  Release_Trie
+    (int t);
+  int  Split
+    (int a, uint64_t ha, int b, uint64_t hb, int level);
+
+public:
+  Best_Path_t &  operator []
+    (int i)
+  {
+    return  node [i];
+  }
+  int  Add
+    (const Best_Path_t & entry);
+  void  Clear
+    (void);
+  void  Extend
+    (int i);
+  int  Find_Cycle
+    (int i)  const;
+  void  Release
+    (int i);
+};
+
+struct Graph_Node_t
+{
+  // A kmer in the subgraph explored from a start for the -G option
+  string  mer;
+    // the kmer as read left to right on the forward strand of the walk
+  unsigned  freq;
+  unsigned  seen [2];
+    // for the right (0) and left (1) walks, bit (8 * frame + open_frame)
+    // is set if the kmer has been reached with that frame and open frames
+  vector <int>  succ;
+    // subscripts of the nodes that follow this one
+  int  in_degr;
+  int  pred;
+    // the node before this one if in_degr is 1
+  int  seg;
+    // the GFA segment containing this node, -1 if not assigned yet
+};
+
+struct Graph_State_t
+{
+  // A kmer node reached by the -G exploration and the walk state there
+  int  node;
+  int  step;
+  unsigned  frame : 2;
+  unsigned  open_frame : 3;
+};
+
+struct Path_Mer_t
+{
+  // A kmer on the walk path or, with the -U option, a run of
+  // consecutive kmers of one unitig
+  const Kmer_Info_t  * info;
+    // hash entry of the kmer, or of the unitig's first kmer, which
+    // identifies it
+  int  pos;
+    // position on the result string of the rightmost base of the
+    // (first) kmer
+  unsigned  fwd_ori;
+    // true iff the kmer appears on the path in its canonical
+    // orientation, or the path reads the unitig left to right
+  int  first, len;
+    // unitig offset of the run's first kmer and its number of kmers;
+    // 0 and 1 for a single kmer
+};
+
+class Path_Set_t
+{
+  // The kmers (or unitig runs) on the current walk path, in the order
+  // they were added, with an open-addressing hash table to find them.
+  // Entries are only removed last-in first-out, as the walk backtracks,
+  // so a removed slot can simply be emptied without breaking any probe
+  // sequence.
+private:
+  vector <Path_Mer_t>  path;
+    // entries in order added; also the depth stack
+  vector <int>  table;
+    // subscripts into path, or -1 for an empty slot
+  unsigned  mask;
+
+  unsigned  Probe
+    (const Kmer_Info_t * info, unsigned fwd_ori);
+  void  Rehash
+    (unsigned size);
+
+public:
+  Path_Set_t
+    ()
+  {
+    Rehash (INITIAL_PATH_TABLE);
+  }
+  void  Clear
+    (void);
+  bool  Empty
+    (void)
+  {
+    return  path . empty ();
+  }
+  const Path_Mer_t *  Find
+    (const Kmer_Info_t * info, unsigned fwd_ori);
+  void  Pop
+    (void);
+  void  Push
+    (const Kmer_Info_t * info, unsigned fwd_ori, int pos, int first = 0,
+     int len = 1);
+  int  Top_Pos
+    (void)
+  {
+    return  path . back () . pos;
+  }
+};
+
+class Stop_Set_t
+{
+  // The stop patterns from the -s option, with the patterns of each
+  // length in a hash of binary kmers, so checking whether a walk kmer
+  // starts or ends with any of them takes one lookup per distinct
+  // pattern length, no matter how many patterns there are.
+private:
+  vector <int>  len;
+    // the distinct pattern lengths
+  vector <Kmer_Hash_t <int> *>  hash;
+    // hash [i] has the patterns of length len [i], each with the
+    // subscript of its first occurrence in the input
+
+public:
+  ~ Stop_Set_t
+    ();
+  void  Add
+    (const char * s, int sub);
+  int  Find
+    (const char * fmer, char dir);
+};
+
+struct Unitig_Pos_t
+{
+  const Kmer_Info_t  * info;
+    // hash entry of the kmer, NULL for an empty slot
+  unsigned  unitig, offset;
+    // subscript of the unitig containing the kmer and its position in it
+};
+
+class Unitig_Index_t
+{
+  // The unitig and offset of each kmer, found from its hash entry with
+  // an open-addressing hash table.  It's kept apart from Kmer_Info_t
+  // so that kmers take no extra memory unless the -U option is used.
+private:
+  vector <Unitig_Pos_t>  table;
+  unsigned  mask;
+
+  unsigned  Probe
+    (const Kmer_Info_t * info)  const;
+
+public:
+  const Unitig_Pos_t *  Find
+    (const Kmer_Info_t * info)  const;
+  void  Reserve
+    (size_t n);
+  void  Set
+    (const Kmer_Info_t * info, unsigned unitig, unsigned offset);
+};
+
+struct Unitig_Graph_t
+{
+  // Maximal non-branching paths of kmers.  Every kmer in the interior
+  // of a unitig has exactly one successor and the next kmer has exactly
+  // one predecessor, so a walk can go through a whole unitig at once.
+  string  seq;
+    // sequences of all unitigs, one after another
+  vector <size_t>  seq_start;
+    // seq_start [u] is the start of unitig u in seq
+  vector <size_t>  first_mer;
+    // first_mer [u] is the subscript in mer of the first kmer of
+    // unitig u; there's an extra entry at the end
+  vector <Kmer_Info_t *>  mer;
+    // hash entries of the kmers of all unitigs, in unitig order
+  vector <bool>  fwd;
+    // fwd [i] is true iff the unitig reads mer [i] in its canonical form
+  Unitig_Index_t  index;
+    // unitig and offset of each kmer in mer
+};
+
+struct Walk_Output_t
+{
+  std :: mutex  lock;
+  vector <char *>  buff;
+    // buff [k] is the output of the walks from start k when they're
+    // done; NULL until then
+  vector <size_t>  len;
+    // length of each buff entry
+  int  next;
+    // subscript of the next start whose output is to be printed
+};
+
 struct Adj_t
 {
   int  id;
@@ -85,26 +367,63 @@ struct Node_t
 };
 
 
+static void  Best_Paths_From_Start
+  (FILE * fp, Kmer_Hash_t <Kmer_Info_t> & kmer_hash, const char * start,
+   const char * tag, char start_dir, vector <char *> & stop_pattern,
+   Stop_Set_t * stop_set);
+static void  Build_Unitigs
+  (Kmer_Hash_t <Kmer_Info_t> & kmer_hash, Unitig_Graph_t & unitigs);
 static bool  Check_Stops
-  (vector <char *> & stop_pattern, char * fmer, char dir, int & pattern_sub);
+  (Stop_Set_t * stop_set, char * fmer, char dir, int & pattern_sub);
+static bool  Claim_Kmer
+  (Kmer_Info_t * p, bool fwd_ori);
 char  Complement
   (char ch);
-static bool  Is_Stop
-  (const char * codon);
-static int  Num_Open
-  (unsigned char open_frame);
+static void  Add_Graph_Edge
+  (vector <Graph_Node_t> & node, int from, int to);
+static void  Get_Walk_Mers
+  (Kmer_Hash_t <Kmer_Info_t> & kmer_hash, const Binary_Mer_t & mer,
+   bool fwd_ori, char * fmer, char * rmer);
+static void  Graph_From_Start
+  (FILE * fp, Kmer_Hash_t <Kmer_Info_t> & kmer_hash, const char * start,
+   const char * tag, char start_dir, Stop_Set_t * stop_set);
+static int  Graph_Node
+  (Kmer_Hash_t <Kmer_Info_t> & kmer_hash, Kmer_Hash_t <int> & index,
+   vector <Graph_Node_t> & node, const char * mer);
+static bool  Is_Used
+  (const Kmer_Info_t & info, bool fwd_ori);
+static bool  Keep_Result
+  (int len, const char * expl);
 static void  Parse_Command_Line
   (int argc, char * argv []);
 void  Print_If_Used
   (FILE * fp, const char * s, const Kmer_Info_t & info);
 static void  Print_Result
-  (FILE * fp, char * s, int lo, int hi, char * id, unsigned ver, const char * expl);
+  (FILE * fp, char * s, int lo, int hi, const char * id, unsigned ver,
+   const char * expl, vector <size_t> * ver_pos = NULL);
 void  Reverse_Complement
   (char * s);
 static int  Set_Open_Frame
   (unsigned char open_frame, const char * s, int offset);
+static int  Unitig_Run
+  (const Unitig_Graph_t * unitigs, const Kmer_Info_t * p, bool fwd_ori,
+   char dir, unsigned & u, int & offset, bool & along);
 static void  Usage
   (void);
+static void  Walk_From_Start
+  (FILE * fp, Kmer_Hash_t <Kmer_Info_t> & kmer_hash,
+   const Unitig_Graph_t * unitigs, const char * start, const char * tag,
+   char start_dir, vector <char *> & stop_pattern, Stop_Set_t * stop_set);
+static void  Walk_One_Dir
+  (FILE * fp, Kmer_Hash_t <Kmer_Info_t> & kmer_hash,
+   const Unitig_Graph_t * unitigs, const char * start, const char * tag,
+   char dir, vector <char *> & stop_pattern, Stop_Set_t * stop_set,
+   bool start_claimed, unsigned & variant, vector <size_t> * ver_pos);
+static void  Walk_Worker
+  (Kmer_Hash_t <Kmer_Info_t> * kmer_hash, const Unitig_Graph_t * unitigs,
+   vector <char *> * start_kmer, vector <char *> * walk_tag,
+   vector <char> * walk_dir, vector <char *> * stop_pattern,
+   Stop_Set_t * stop_set, std :: atomic <int> * next, Walk_Output_t * out);
 
 
 #endif
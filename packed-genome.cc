@@ -0,0 +1,358 @@
+//  A. L. Delcher
+//
+//  File:  packed-genome.cc
+//
+//  Last Modified:  19 Oct 2026
+//
+//  A file of DNA sequences stored with 2 bits per base, which is
+//  mapped into memory so any region can be read without parsing text
+
+
+#include  "packed-genome.hh"
+
+#include  <fcntl.h>
+#include  <sys/mman.h>
+#include  <sys/stat.h>
+#include  <unistd.h>
+
+
+static const char  FWD_BASE [] = "ACGT";
+static const char  REV_BASE [] = "TGCA";
+  // Characters of the 2-bit codes on each strand
+
+
+
+static size_t  Next_Bit
+    (const vector <uint64_t> & bits, size_t n, size_t from, bool value)
+
+//  Return the position of the first bit at or after  from  in the
+//  first  n  bits of  bits  that equals  value , or  n  if there's
+//  none.  Skips 64 bits at a time.
+
+  {
+   uint64_t  m;
+   size_t  w;
+
+   if  (n <= from)
+       return  n;
+
+   w = from >> 6;
+   m = (value ? bits [w] : ~ bits [w]) & (~ uint64_t (0) << (from & 63));
+   while  (m == 0)
+     {
+      if  (++ w << 6 >= n)
+          return  n;
+      m = (value ? bits [w] : ~ bits [w]);
+     }
+
+   return  Min ((w << 6) + __builtin_ctzll (m), n);
+  }
+
+
+
+static void  Write_Padded
+    (FILE * fp, const void * buff, size_t n, uint64_t & offset)
+
+//  Write the  n  bytes in  buff  to  fp  followed by zeroes to make
+//  a multiple of 8 bytes, and add the bytes written to  offset .
+
+  {
+   static const char  zero [8] = {0};
+
+   fwrite (buff, 1, n, fp);
+   fwrite (zero, 1, (8 - n % 8) % 8, fp);
+   offset += n + (8 - n % 8) % 8;
+
+   return;
+  }
+
+
+
+Packed_Genome_t :: Packed_Genome_t
+    ()
+
+  {
+   data = NULL;
+   data_len = 0;
+   entry = NULL;
+   num_seqs = 0;
+  }
+
+
+
+Packed_Genome_t :: ~ Packed_Genome_t
+    ()
+
+  {
+   if  (data != NULL)
+       munmap ((void *) data, data_len);
+  }
+
+
+
+bool  Packed_Genome_t :: Extract
+    (string & s, const char * id, long int lo, long int hi, char strand)
+
+//  Set  s  to the region  lo .. hi  of the sequence named  id , in
+//  0-based between coordinates, e.g., the first 3 bases are lo=0, hi=3.
+//  The region is clipped to the sequence.  If  strand  is '-' set  s
+//  to the reverse complement of the region.  Bases are upper case.
+//  Return  true  if  id  is in the file; false, otherwise.
+
+  {
+   const unsigned char  * code;
+   const uint64_t  * run;
+   const char  * alpha;
+   long int  i, j, k, n, pos, run_lo, run_hi;
+
+   s . erase ();
+
+   i = Find (id);
+   if  (i < 0)
+       return  false;
+
+   lo = Max (lo, 0L);
+   hi = Min (hi, Len (i));
+   if  (hi <= lo)
+       return  true;
+
+   n = hi - lo;
+   s . resize (n);
+   code = (const unsigned char *) (data + entry [i] . code_offset);
+   alpha = (strand == '-' ? REV_BASE : FWD_BASE);
+   for  (pos = lo;  pos < hi;  pos ++)
+     {
+      j = (strand == '-' ? hi - 1 - pos : pos - lo);
+      s [j] = alpha [(code [pos >> 2] >> (2 * (pos & 3))) & 3];
+     }
+
+   // Put back the N's.  Runs are in order, so binary search for the
+   // first one ending after  lo
+   run = Runs (i);
+   j = 0;
+   k = entry [i] . num_runs;
+   while  (j < k)
+     {
+      long int  mid = (j + k) / 2;
+
+      if  (long (run [2 * mid] + run [2 * mid + 1]) <= lo)
+          j = mid + 1;
+        else
+          k = mid;
+     }
+   for  ( ;  j < long (entry [i] . num_runs) && long (run [2 * j]) < hi;  j ++)
+     {
+      run_lo = Max (long (run [2 * j]), lo);
+      run_hi = Min (long (run [2 * j] + run [2 * j + 1]), hi);
+      for  (pos = run_lo;  pos < run_hi;  pos ++)
+        s [strand == '-' ? hi - 1 - pos : pos - lo] = 'N';
+     }
+
+   return  true;
+  }
+
+
+
+long int  Packed_Genome_t :: Find
+    (const char * id)
+
+//  Return the subscript of the sequence named  id , or  -1
+//  if there is none.
+
+  {
+   map <string, long int> :: const_iterator  p;
+
+   p = lookup . find (id);
+   if  (p == lookup . end ())
+       return  -1;
+
+   return  p -> second;
+  }
+
+
+
+bool  Packed_Genome_t :: Is_Packed
+    (const char * fname)
+
+//  Return  true  iff file  fname  starts like a packed genome file.
+
+  {
+   FILE  * fp;
+   char  magic [8];
+   bool  result;
+
+   fp = fopen (fname, "r");
+   if  (fp == NULL)
+       return  false;
+
+   result = (fread (magic, 1, 8, fp) == 8
+               && memcmp (magic, PACKED_GENOME_MAGIC, 8) == 0);
+   fclose (fp);
+
+   return  result;
+  }
+
+
+
+void  Packed_Genome_t :: Open
+    (const char * fname)
+
+//  Map the packed genome file  fname  into memory and check that its
+//  entries are all inside it.  Exit with a message if it's not a
+//  packed genome file or is damaged.
+
+  {
+   const Packed_Genome_Hdr_t  * hdr;
+   struct stat  st;
+   size_t  max_seqs;
+   long int  i;
+   int  fd;
+
+   filename = fname;
+
+   fd = open (fname, O_RDONLY);
+   if  (fd < 0 || fstat (fd, & st) != 0)
+       {
+        sprintf (Clean_Exit_Msg_Line, "ERROR:  Could not open file  %s", fname);
+        Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+       }
+
+   data_len = st . st_size;
+   if  (data_len < sizeof (Packed_Genome_Hdr_t))
+       {
+        sprintf (Clean_Exit_Msg_Line,
+             "ERROR:  %s is not a packed genome file", fname);
+        Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+       }
+   data = (const char *) mmap (NULL, data_len, PROT_READ, MAP_PRIVATE, fd, 0);
+   if  (data == MAP_FAILED)
+       {
+        sprintf (Clean_Exit_Msg_Line, "ERROR:  Could not map file  %s", fname);
+        Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+       }
+   close (fd);
+
+   hdr = (const Packed_Genome_Hdr_t *) data;
+   if  (memcmp (hdr -> magic, PACKED_GENOME_MAGIC, 8) != 0)
+       {
+        sprintf (Clean_Exit_Msg_Line,
+             "ERROR:  %s is not a packed genome file", fname);
+        Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+       }
+
+   max_seqs = 0;
+   if  (hdr -> table_offset <= data_len && hdr -> table_offset % 8 == 0)
+       max_seqs = (data_len - hdr -> table_offset)
+                    / sizeof (Packed_Genome_Entry_t);
+   if  (max_seqs < hdr -> num_seqs)
+       {
+        sprintf (Clean_Exit_Msg_Line,
+             "ERROR:  Packed genome file %s is truncated", fname);
+        Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+       }
+
+   num_seqs = hdr -> num_seqs;
+   entry = (const Packed_Genome_Entry_t *) (data + hdr -> table_offset);
+   lookup . clear ();
+   for  (i = 0;  i < num_seqs;  i ++)
+     {
+      const Packed_Genome_Entry_t  & e = entry [i];
+
+      if  (data_len <= e . id_offset || data_len - e . id_offset <= e . id_len
+             || data [e . id_offset + e . id_len] != '\0'
+             || data_len < e . code_offset
+             || data_len - e . code_offset < (e . len + 3) / 4
+             || data_len < e . run_offset || e . run_offset % 8 != 0
+             || (data_len - e . run_offset) / (2 * sizeof (uint64_t))
+                  < e . num_runs)
+          {
+           sprintf (Clean_Exit_Msg_Line,
+                "ERROR:  Packed genome file %s is damaged at sequence %ld",
+                fname, i + 1);
+           Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+          }
+
+      if  (lookup . find (Id (i)) != lookup . end ())
+          fprintf (stderr, "WARNING:  Duplicate sequence id %s in %s\n",
+               Id (i), fname);
+        else
+          lookup [Id (i)] = i;
+     }
+
+   return;
+  }
+
+
+
+long int  Packed_Genome_t :: Write
+    (Seq_Reader_t & reader, const char * fname)
+
+//  Write all the sequences from  reader  to file  fname  as a packed
+//  genome.  Each sequence is packed as it's read, so only one is in
+//  memory at a time.  Return the number of sequences written.
+
+  {
+   FILE  * fp;
+   Packed_Genome_Hdr_t  hdr;
+   Packed_Genome_Entry_t  e;
+   vector <Packed_Genome_Entry_t>  table;
+   vector <uint64_t>  run;
+   Packed_Seq_t  packed;
+   string  s, tag, id;
+   uint64_t  offset;
+   size_t  n, lo, hi;
+
+   fp = File_Open (fname, "w");
+
+   memset (& hdr, 0, sizeof (hdr));
+   memcpy (hdr . magic, PACKED_GENOME_MAGIC, 8);
+   offset = 0;
+   Write_Padded (fp, & hdr, sizeof (hdr), offset);
+
+   while  (reader . Next (s, tag))
+     {
+      id = tag . substr (0, tag . find_first_of (" \t\r\n\f\v"));
+      n = s . length ();
+
+      e . id_offset = offset;
+      e . id_len = id . length ();
+      Write_Padded (fp, id . c_str (), id . length () + 1, offset);
+
+      Encode_Seq (s . c_str (), n, packed);
+      run . clear ();
+      for  (lo = Next_Bit (packed . bad, n, 0, true);  lo < n;
+              lo = Next_Bit (packed . bad, n, hi, true))
+        {
+         hi = Next_Bit (packed . bad, n, lo, false);
+         run . push_back (lo);
+         run . push_back (hi - lo);
+        }
+      e . run_offset = offset;
+      e . num_runs = run . size () / 2;
+      Write_Padded (fp, run . data (), run . size () * sizeof (uint64_t),
+           offset);
+
+      e . code_offset = offset;
+      e . len = n;
+      Write_Padded (fp, packed . code . data (), packed . code . size (),
+           offset);
+
+      table . push_back (e);
+     }
+
+   hdr . num_seqs = table . size ();
+   hdr . table_offset = offset;
+   fwrite (table . data (), sizeof (Packed_Genome_Entry_t), table . size (),
+        fp);
+   rewind (fp);
+   fwrite (& hdr, sizeof (hdr), 1, fp);
+
+   if  (ferror (fp) || fclose (fp) != 0)
+       {
+        sprintf (Clean_Exit_Msg_Line, "ERROR:  Could not write file  %s",
+             fname);
+        Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+       }
+
+   return  long (table . size ());
+  }
@@ -0,0 +1,107 @@
+//  A. L. Delcher
+//
+//  File:  packed-genome.hh
+//
+//  Last Modified:  19 Oct 2026
+//
+//  A file of DNA sequences stored with 2 bits per base, which is
+//  mapped into memory so any region can be read without parsing text
+
+
+#ifndef  __PACKED_GENOME_H_INCLUDED
+#define  __PACKED_GENOME_H_INCLUDED
+
+
+#include  "delcher.hh"
+#include  "fasta.hh"
+#include  "seq-encode.hh"
+#include  <stdint.h>
+
+
+const char  PACKED_GENOME_MAGIC [] = "ETHAPK01";
+  // First 8 bytes of a packed genome file
+
+
+struct  Packed_Genome_Hdr_t
+  {
+   // The start of a packed genome file.  After it come, for each
+   // sequence, its id, then its N runs, then its 2-bit codes, each
+   // padded to a multiple of 8 bytes, and then the table of entries.
+   // Everything is written in the byte order of the machine.
+   char  magic [8];
+   uint64_t  num_seqs;
+   uint64_t  table_offset;
+     // position in the file of the first  Packed_Genome_Entry_t
+  };
+
+
+struct  Packed_Genome_Entry_t
+  {
+   uint64_t  id_offset, id_len;
+     // position in the file and length of the id, which is
+     // followed by a  '\0'
+   uint64_t  len;
+     // number of bases in the sequence
+   uint64_t  code_offset;
+     // position in the file of the 2-bit codes as written by
+     // Encode_Seq :  A = 0, C = 1, G = 2, T = 3, 4 to a byte with the
+     // first base in the low bits
+   uint64_t  run_offset, num_runs;
+     // position in the file and number of the N runs, each of which
+     // is a pair of  uint64_t  (start, length) , in order of start
+  };
+
+
+class  Packed_Genome_t
+  {
+   // A packed genome file mapped into memory.  Bases are A, C, G, T
+   // or N:  all other characters are stored as N, which are kept as
+   // a list of runs since they're rare and usually come together, and
+   // upper and lower case aren't distinguished.  That takes about a
+   // quarter of the space of a fasta file, and  Extract  decodes a
+   // region from just the bytes that hold it.  Sequences are named by
+   // the first word of their fasta header, as in a  .fai  index.
+   private:
+     string  filename;
+     const char  * data;
+     size_t  data_len;
+       // the file as mapped into memory
+     const Packed_Genome_Entry_t  * entry;
+     long int  num_seqs;
+     map <string, long int>  lookup;
+       // subscript in  entry  of each id
+
+     const uint64_t *  Runs
+         (long int i)  const
+       { return  (const uint64_t *) (data + entry [i] . run_offset); }
+
+   public:
+     Packed_Genome_t
+         ();
+     ~ Packed_Genome_t
+         ();
+     bool  Extract
+         (string & s, const char * id, long int lo, long int hi,
+          char strand = '+');
+     long int  Find
+         (const char * id);
+     const char *  Id
+         (long int i)  const
+       { return  data + entry [i] . id_offset; }
+     long int  Len
+         (long int i)  const
+       { return  long (entry [i] . len); }
+     int  Num_Seqs
+         (void)  const
+       { return  int (num_seqs); }
+     void  Open
+         (const char * fname);
+
+     static bool  Is_Packed
+         (const char * fname);
+     static long int  Write
+         (Seq_Reader_t & reader, const char * fname);
+  };
+
+
+#endif
@@ -8,13 +8,18 @@
 //  files named as arguments (one sequence per line, no other
 //  information).  It then reads a multifasta file from stdin and
 //  outputs for each sequence the regions that are bounded by exact
-//  primer matches.  Output is the fasta header line for each fasta
-//  sequence.  Then one line for each match (if any) consisting of:
+//  primer matches, or matches with up to k mismatches with the -k
+//  option.  All primers are found on both strands in one pass over
+//  each sequence, with an Aho-Corasick automaton for exact matches or
+//  a bit-parallel Shift-And matcher for mismatches.  Output is the
+//  fasta header line for each fasta sequence.  Then one line for each
+//  match (if any) consisting of:
 //    lo-pos  hi-pos  len  lo-primer  hi-primer
 //  where lo-pos and hi-pos are the positions (counting from 1) of the
 //  matched regions (including primers); len in the length of the
 //  matched region; lo-primer and hi-primer are the number and which
 //  primer file (fwd or rev) the primer matching each position was.
+//  With -k the numbers of mismatches of the lo and hi primers follow.
 
 
 #include  "primer-pair-matches.hh"
@@ -30,6 +35,12 @@ extern int  Global_Debug_Flag;
 
 static char  * Fwd_Primer_Filename = NULL;
   // Name of file with list of forward primer sequences
+static int  Max_Len = INT_MAX;
+  // Longest region between primer matches to report, set by -M option
+static int  Max_Mismatches = 0;
+  // Most mismatches allowed in a primer match, set by -k option
+static int  Num_Threads = 1;
+  // Number of worker threads matching sequences, set by -t option
 static char  * Rev_Primer_Filename = NULL;
   // Name of file with list of reverse primer sequences
 
@@ -40,9 +51,10 @@ int  main
 {
   FILE  * fp;
   vector <char *>  fwd_primer, rev_primer;
-  string  seq, hdr;
+  vector <Primer_t>  primer;
+  Aho_Corasick_t  exact;
+  Shift_And_t  approx;
   char  line [MAX_LINE];
-  long int  len;
   int  num_fwd, num_rev;
   int  i, n;
 
@@ -56,8 +68,9 @@ int  main
       n = strlen (line);
       if (0 < n && line [n - 1] == '\n')
         line [-- n] = '\0';
-      for (i = 0; i < n; i ++)
-        line [i] = tolower (line [i]);
+      Upper_Case_Seq (line, n);
+      if (n == 0)
+        continue;
       // Maybe check for duplicates here?
       fwd_primer . push_back (strdup (line));
     }
@@ -78,8 +91,9 @@ int  main
       n = strlen (line);
       if (0 < n && line [n - 1] == '\n')
         line [-- n] = '\0';
-      for (i = 0; i < n; i ++)
-        line [i] = tolower (line [i]);
+      Upper_Case_Seq (line, n);
+      if (n == 0)
+        continue;
       // Maybe check for duplicates here?
       rev_primer . push_back (strdup (line));
     }
@@ -94,115 +108,188 @@ int  main
         printf ("%2d  %s\n", i, rev_primer [i]);
     }
 
-
-  while (Fasta_Read (stdin, seq, hdr))
+  // Match all primers on both strands in one pass over each sequence
+  for (i = 0; i < num_fwd; i ++)
+    Add_Primer (primer, fwd_primer [i], 'f', i);
+  for (i = 0; i < num_rev; i ++)
+    Add_Primer (primer, rev_primer [i], 'r', i);
+  n = primer . size ();
+  for (i = 0; i < n; i ++)
+    if (0 < Max_Mismatches)
+      approx . Add (primer [i] . seq . c_str ());
+    else
+      exact . Add (primer [i] . seq . c_str ());
+  if (0 < Max_Mismatches)
+    approx . Build (Max_Mismatches);
+  else
+    exact . Build ();
+
+  Seq_Reader_t  seq_reader (stdin);
+  Seq_Pipeline_t <Seq_Record_t>  pipeline;
+
+  pipeline . process
+    = [& exact, & approx, & primer] (Seq_Record_t & r, FILE * fp)
     {
-      vector <Match_t>  fwd_match, rev_match;
-      Match_t  m;
-      size_t  p;
-      int  nf, nr;
-      int  j;
+      Find_Primer_Pairs (r, fp, exact, approx, primer);
+    };
+  pipeline . Run (seq_reader, stdout, Num_Threads);
 
-      len = seq . length ();
+  return  0;
+}
 
-      printf (">%s\n", hdr . c_str ());
 
-      for (i = 0; i < len; i ++)
-        seq [i] = tolower (seq [i]);
+static void  Add_Primer
+  (vector <Primer_t> & primer, const char * s, char primer_dir, int which)
 
-      // Find matches to the forward strand and put them in fwd_match
-      for (j = 0; j < num_fwd; j ++)
-        {
-          for (p = 0; (p = seq . find (fwd_primer [j], p)) != string :: npos; p ++)
-            {
-              m . primer_dir = 'f';
-              m . which = j;
-              m . pos = int (p + 1);  // adjust to start-at-one coords
-              fwd_match . push_back (m);
-            }
-        }
+// Add primer sequence s, which is number which in the primer_dir ('f'
+// or 'r') primer file, to primer, both as it is and reverse-complemented.
+// Subscripts in primer are the pattern subscripts of the matchers.
 
-      for (j = 0; j < num_rev; j ++)
-        {
-          for (p = 0; (p = seq . find (rev_primer [j], p)) != string :: npos; p ++)
-            {
-              m . primer_dir = 'r';
-              m . which = j;
-              m . pos = int (p + 1);  // adjust to start-at-one coords
-              fwd_match . push_back (m);
-            }
-        }
+{
+  Primer_t  p;
 
-      if (0 < Verbose)
-        {
-          nf = fwd_match . size ();
-          if (0 < nf)
-            printf ("Forward matches:\n");
-          for (i = 0; i < nf; i ++)
-            printf ("%6d %4d %c\n", fwd_match [i] . pos, fwd_match [i] . which,
-                    fwd_match [i] . primer_dir);
-        }
+  p . primer_dir = primer_dir;
+  p . which = which;
+  p . len = strlen (s);
 
-      Reverse_Complement (seq);
+  p . seq = s;
+  p . strand = '+';
+  primer . push_back (p);
 
-      // Find matches to the reverse strand and put them in rev_match
-      for (j = 0; j < num_rev; j ++)
-        {
-          for (p = 0; (p = seq . find (fwd_primer [j], p)) != string :: npos; p ++)
-            {
-              m . primer_dir = 'f';
-              m . which = j;
-              m . pos = int (len - p);  // position of last base on fwd strand
-              rev_match . push_back (m);
-            }
-        }
+  Reverse_Complement (p . seq);
+  p . strand = '-';
+  primer . push_back (p);
+
+  return;
+}
+
+
+static char  Complement
+  (char ch)
+
+// Returns the DNA complement of  ch
+
+{
+  return  COMPLEMENT_TABLE [unsigned (ch)];
+}
+
+
+static void  Find_Primer_Pairs
+  (Seq_Record_t & r, FILE * fp, const Aho_Corasick_t & exact,
+   const Shift_And_t & approx, const vector <Primer_t> & primer)
+
+// Print to fp the header of sequence r and the regions of it bounded
+// by matches to the primers described in primer, found with approx if
+// mismatches are allowed and otherwise with exact.  Run by the pipeline
+// workers, so it may run concurrently for different sequences.
+
+{
+  vector <Pattern_Match_t>  hit;
+  vector <Match_t>  fwd_match, rev_match;
+  Match_t  m;
+  long int  len;
+  int  nf, nr;
+  int  i, j, lo, n;
+
+  len = r . seq . length ();
+
+  fprintf (fp, ">%s\n", r . hdr . c_str ());
+
+  Upper_Case_Seq (& r . seq [0], len);
+  if (0 < Max_Mismatches)
+    approx . Scan (r . seq . c_str (), len, hit);
+  else
+    exact . Scan (r . seq . c_str (), len, hit);
+
+  // Primers matched as given are on the forward strand and go in
+  // fwd_match at their first base.  Reverse-complemented ones are on
+  // the reverse strand and go in rev_match at their last base on the
+  // forward strand, which is where they start on the reverse strand.
+  n = hit . size ();
+  for (i = 0; i < n; i ++)
+    {
+      const Primer_t  & p = primer [hit [i] . pattern];
 
-      for (j = 0; j < num_rev; j ++)
+      m . primer_dir = p . primer_dir;
+      m . strand = p . strand;
+      m . which = p . which;
+      m . mismatches = hit [i] . mismatches;
+      if (p . strand == '+')
         {
-          for (p = 0; (p = seq . find (rev_primer [j], p)) != string :: npos; p ++)
-            {
-              m . primer_dir = 'r';
-              m . which = j;
-              m . pos = int (len - p);  // position of last base on fwd strand
-              rev_match . push_back (m);
-            }
+          m . pos = int (hit [i] . end - p . len + 2);
+          fwd_match . push_back (m);
         }
-
-      if (0 < Verbose)
+      else
         {
-          nr = rev_match . size ();
-          if (0 < nr)
-            printf ("Reverse matches:\n");
-          for (i = 0; i < nr; i ++)
-            printf ("%6d %4d %c\n", rev_match [i] . pos, rev_match [i] . which,
-                    rev_match [i] . primer_dir);
+          m . pos = int (hit [i] . end + 1);
+          rev_match . push_back (m);
         }
+    }
 
-      // Print pairs of valid matches
+  // Hits are found in order of their last base, but the forward ones
+  // are wanted in order of their first, and ties are in no set order
+  sort (fwd_match . begin (), fwd_match . end (), Match_Pos_Less);
+  sort (rev_match . begin (), rev_match . end (), Match_Pos_Less);
+
+  if (0 < Verbose)
+    {
       nf = fwd_match . size ();
-      nr = rev_match . size ();
+      if (0 < nf)
+        fprintf (fp, "Forward matches:\n");
       for (i = 0; i < nf; i ++)
-        for (j = 0; j < nr; j ++)
-          if (fwd_match [i] . pos < rev_match [j] . pos)
-            printf ("%6d %6d %5d  %4d %c %4d %c\n",
-                    fwd_match [i] . pos, rev_match [i] . pos,
-                    1 + rev_match [i] . pos - fwd_match [i] . pos,
-                    fwd_match [i] . which, fwd_match [i] . primer_dir,
-                    rev_match [i] . which, rev_match [i] . primer_dir);
+        Print_Match (fp, fwd_match [i]);
+    }
+
+  if (0 < Verbose)
+    {
+      nr = rev_match . size ();
+      if (0 < nr)
+        fprintf (fp, "Reverse matches:\n");
+      for (i = 0; i < nr; i ++)
+        Print_Match (fp, rev_match [i]);
+    }
 
+  // Print pairs of valid matches.  Both lists are in position order, so
+  // the reverse matches after each forward one start at lo, which only
+  // moves ahead, and end at the first one too far away to pair with it.
+  nf = fwd_match . size ();
+  nr = rev_match . size ();
+  for (i = lo = 0; i < nf; i ++)
+    {
+      while (lo < nr && rev_match [lo] . pos <= fwd_match [i] . pos)
+        lo ++;
+      for (j = lo; j < nr
+             && rev_match [j] . pos - fwd_match [i] . pos < Max_Len; j ++)
+        {
+          fprintf (fp, "%6d %6d %5d  %4d %c %4d %c",
+                   fwd_match [i] . pos, rev_match [j] . pos,
+                   1 + rev_match [j] . pos - fwd_match [i] . pos,
+                   fwd_match [i] . which, fwd_match [i] . primer_dir,
+                   rev_match [j] . which, rev_match [j] . primer_dir);
+          if (0 < Max_Mismatches)
+            fprintf (fp, "  %2d %2d", fwd_match [i] . mismatches,
+                     rev_match [j] . mismatches);
+          fprintf (fp, "\n");
+        }
     }
 
-  return  0;
+  return;
 }
 
 
-static char  Complement
-  (char ch)
+static bool  Match_Pos_Less
+  (const Match_t & a, const Match_t & b)
 
-// Returns the DNA complement of  ch
+// Return true iff match a should be listed before match b, i.e.,
+// it's at an earlier position, with ties broken by primer file
+// and then primer number.
 
 {
-  return  COMPLEMENT_TABLE [unsigned (ch)];
+  if (a . pos != b . pos)
+    return  a . pos < b . pos;
+  if (a . primer_dir != b . primer_dir)
+    return  a . primer_dir < b . primer_dir;
+  return  a . which < b . which;
 }
 
 
@@ -219,7 +306,7 @@ static void  Parse_Command_Line
   optarg = NULL;
 
   while  (! errflg
-          && ((ch = getopt (argc, argv, "hV:")) != EOF))
+          && ((ch = getopt (argc, argv, "hk:M:t:V:")) != EOF))
 
     switch  (ch)
       {
@@ -227,6 +314,36 @@ static void  Parse_Command_Line
         Usage ();
         exit (EXIT_SUCCESS);
 
+      case  'k' :
+        Max_Mismatches = strtol (optarg, NULL, 10);
+        if (Max_Mismatches < 0)
+          {
+            fprintf (stderr, "ERROR:  Bad -k option (mismatches) value %d\n",
+                     Max_Mismatches);
+            errflg = true;
+          }
+        break;
+
+      case  'M' :
+        Max_Len = strtol (optarg, NULL, 10);
+        if (Max_Len < 1)
+          {
+            fprintf (stderr, "ERROR:  Bad -M option (max length) value %d\n",
+                     Max_Len);
+            errflg = true;
+          }
+        break;
+
+      case  't' :
+        Num_Threads = strtol (optarg, NULL, 10);
+        if (Num_Threads < 1)
+          {
+            fprintf (stderr, "ERROR:  Bad -t option (threads) value %d\n",
+                     Num_Threads);
+            errflg = true;
+          }
+        break;
+
       case  'V' :
         Verbose = strtol (optarg, NULL, 10);
         break;
@@ -248,6 +365,23 @@ static void  Parse_Command_Line
 }
 
 
+static void  Print_Match
+  (FILE * fp, const Match_t & m)
+
+// Print to fp the position, primer and strand of match m, and its
+// number of mismatches if they're allowed.
+
+{
+  fprintf (fp, "%6d %4d %c %c", m . pos, m . which, m . primer_dir,
+           m . strand);
+  if (0 < Max_Mismatches)
+    fprintf (fp, " %2d", m . mismatches);
+  fprintf (fp, "\n");
+
+  return;
+}
+
+
 static void  Reverse_Complement
   (string & s)
 
@@ -257,6 +391,8 @@ static void  Reverse_Complement
   unsigned  i, j, n;
 
   n =  s . length ();
+  if  (n == 0)
+    return;
   for  (i = 0, j = n - 1;  i < j;  i ++, j --)
     {
       char  ch;
@@ -285,19 +421,29 @@ static void  Usage
     "\n"
     "Reads forward and reverse primer sequences from files\n"
     "<fwd-primers> and <rev-primers> (one sequence per line, no other\n"
-    "information).  Then read a multifasta file from stdin and\n"
+    "information).  Then read a multifasta or fastq file, which may be\n"
+    "gzip-compressed, from stdin and\n"
     "output for each sequence the regions that are bounded by exact\n"
-    "primer matches.  Output is the fasta header line for each fasta\n"
+    "primer matches, or matches with up to k mismatches with -k.\n"
+    "Output is the fasta header line for each fasta\n"
     "sequence.  Then one line for each match (if any) consisting of:\n"
     "  lo-pos  hi-pos  len  lo-primer  hi-primer\n"
     "where lo-pos and hi-pos are the positions (counting from 1) of the\n"
     "matched regions (including primers); len in the length of the\n"
     "matched region; lo-primer and hi-primer are the number and which\n"
     "primer file (fwd or rev) the primer matching each position was.\n"
+    "With -k the numbers of mismatches of the lo and hi primers follow.\n"
     "\n"
     "Options:\n"
     " -h\n"
     "    Print this message\n"
+    " -k <n>\n"
+    "    Allow up to <n> mismatches (substitutions only) in primer matches.\n"
+    "    Primers must be at most 64 bases long.  Default is 0\n"
+    " -M <n>\n"
+    "    Only output regions at most <n> bases long.  Default is no limit\n"
+    " -t <n>\n"
+    "    Match sequences with <n> threads.  Output stays in input order\n"
     " -V <n>\n"
     "    Set verbose level to <n>.  Higher values are more debugging output.\n"
     "\n");
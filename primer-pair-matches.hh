@@ -14,6 +14,10 @@
 
 #include  "delcher.hh"
 #include  "fasta.hh"
+#include  "seq-pipeline.hh"
+#include  "seq-encode.hh"
+#include  "aho-corasick.hh"
+#include  "shift-and.hh"
 
 
 const int  MAX_LINE = 1000;
@@ -29,15 +33,37 @@ static const char  COMPLEMENT_TABLE []
 struct  Match_t
   {
     char  primer_dir;  // 'f' for fwd primer; 'r' for rev
+    char  strand;  // '+' for forward strand; '-' for reverse
     int  pos;  // position of match, counting from 1
     int  which;  // subscript of primer
+    int  mismatches;  // number of mismatches with primer
+  };
+
+struct  Primer_t
+  {
+    // A pattern searched for:  a primer either as given or
+    // reverse-complemented
+    char  primer_dir;  // 'f' for fwd primer; 'r' for rev
+    char  strand;  // '+' as given; '-' if reverse-complemented
+    int  which;  // subscript of primer
+    int  len;
+    string  seq;  // pattern searched for
   };
 
 
+static void  Add_Primer
+  (vector <Primer_t> & primer, const char * s, char primer_dir, int which);
 static char  Complement
   (char ch);
+static void  Find_Primer_Pairs
+  (Seq_Record_t & r, FILE * fp, const Aho_Corasick_t & exact,
+   const Shift_And_t & approx, const vector <Primer_t> & primer);
+static bool  Match_Pos_Less
+  (const Match_t & a, const Match_t & b);
 static void  Parse_Command_Line
   (int argc, char * argv []);
+static void  Print_Match
+  (FILE * fp, const Match_t & m);
 static void  Reverse_Complement
   (string & s);
 static void  Usage
@@ -0,0 +1,330 @@
+//  A. L. Delcher
+//
+//  File:  seq-encode.cc
+//
+//  Last Modified:  19 Oct 2026
+//
+//  Routines to convert DNA sequences to upper case and 2-bit codes.
+//  Each conversion is one pass over the sequence that does 32 (AVX2)
+//  or 16 (SSE2) characters at a time, with the kernel chosen when
+//  the program runs from what the processor supports.
+
+
+#include  "seq-encode.hh"
+
+#if  defined (__x86_64__)
+#include  <immintrin.h>
+#endif
+
+
+typedef void  (* Encode_Fn_t)
+    (const char * s, size_t n, unsigned char * code, uint64_t * bad,
+     char * upper);
+
+struct  Encode_Kernel_t
+  {
+   Encode_Fn_t  fn;
+   const char  * name;
+  };
+
+
+
+static void  Encode_Scalar
+    (const char * s, size_t lo, size_t n, unsigned char * code,
+     uint64_t * bad, char * upper)
+
+//  Convert  s [lo .. (n - 1)]  to upper case, storing it in  upper
+//  unless that's  NULL .  Unless  code  is  NULL , OR the 2-bit code
+//  of each base into  code  and the non-ACGT bases into  bad , both of
+//  which must be zero there already.
+
+  {
+   unsigned  a;
+   size_t  i;
+
+   for  (i = lo;  i < n;  i ++)
+     {
+      unsigned char  ch = s [i];
+
+      if  ('a' <= ch && ch <= 'z')
+          ch -= 'a' - 'A';
+      if  (upper != NULL)
+          upper [i] = ch;
+      if  (code == NULL)
+          continue;
+
+      switch  (ch)
+        {
+         case  'A' :
+           a = 0;
+           break;
+         case  'C' :
+           a = 1;
+           break;
+         case  'G' :
+           a = 2;
+           break;
+         case  'T' :
+           a = 3;
+           break;
+         default :
+           a = 0;
+           bad [i >> 6] |= uint64_t (1) << (i & 63);
+        }
+      code [i >> 2] |= a << (2 * (i & 3));
+     }
+
+   return;
+  }
+
+
+
+static void  Encode_Scalar
+    (const char * s, size_t n, unsigned char * code, uint64_t * bad,
+     char * upper)
+
+//  Convert all of  s  a character at a time.
+
+  {
+   Encode_Scalar (s, 0, n, code, bad, upper);
+
+   return;
+  }
+
+
+
+#if  defined (__x86_64__)
+
+//  In both vector kernels the upper-case letters A, C, G and T, which
+//  are 0x41, 0x43, 0x47 and 0x54, become their codes 0 .. 3 with
+//  ((ch >> 1) ^ (ch >> 2)) & 3 .  Shifting 16-bit lanes is fine since
+//  bits shifted in from the next byte are masked off.  Codes are then
+//  packed by folding each pair of adjacent bytes, then each pair of
+//  adjacent 16-bit lanes, into the low byte of every 32-bit lane.
+
+
+__attribute__ ((target ("avx2")))
+static void  Encode_AVX2
+    (const char * s, size_t n, unsigned char * code, uint64_t * bad,
+     char * upper)
+
+//  Convert  s  32 characters at a time with AVX2 instructions.
+
+  {
+   const __m256i  before_a = _mm256_set1_epi8 ('a' - 1);
+   const __m256i  after_z = _mm256_set1_epi8 ('z' + 1);
+   const __m256i  case_bit = _mm256_set1_epi8 ('a' - 'A');
+   const __m256i  ch_a = _mm256_set1_epi8 ('A'), ch_c = _mm256_set1_epi8 ('C');
+   const __m256i  ch_g = _mm256_set1_epi8 ('G'), ch_t = _mm256_set1_epi8 ('T');
+   const __m256i  three = _mm256_set1_epi8 (3);
+   const __m256i  low_byte = _mm256_set1_epi16 (0xff);
+   const __m256i  low_half = _mm256_set1_epi32 (0xffff);
+   const __m256i  zero = _mm256_setzero_si256 ();
+   size_t  i;
+
+   for  (i = 0;  i + 32 <= n;  i += 32)
+     {
+      __m256i  x, lower, good, c;
+      uint32_t  good_bits, w [2];
+
+      x = _mm256_loadu_si256 ((const __m256i *) (s + i));
+      lower = _mm256_and_si256 (_mm256_cmpgt_epi8 (x, before_a),
+                  _mm256_cmpgt_epi8 (after_z, x));
+      x = _mm256_sub_epi8 (x, _mm256_and_si256 (lower, case_bit));
+      if  (upper != NULL)
+          _mm256_storeu_si256 ((__m256i *) (upper + i), x);
+      if  (code == NULL)
+          continue;
+
+      good = _mm256_or_si256
+                 (_mm256_or_si256 (_mm256_cmpeq_epi8 (x, ch_a),
+                      _mm256_cmpeq_epi8 (x, ch_c)),
+                  _mm256_or_si256 (_mm256_cmpeq_epi8 (x, ch_g),
+                      _mm256_cmpeq_epi8 (x, ch_t)));
+      good_bits = _mm256_movemask_epi8 (good);
+      bad [i >> 6] |= uint64_t (~ good_bits) << (i & 63);
+
+      c = _mm256_xor_si256 (_mm256_srli_epi16 (x, 1), _mm256_srli_epi16 (x, 2));
+      c = _mm256_and_si256 (_mm256_and_si256 (c, three), good);
+      c = _mm256_or_si256 (_mm256_and_si256 (c, low_byte),
+              _mm256_srli_epi16 (c, 6));
+      c = _mm256_or_si256 (_mm256_and_si256 (c, low_half),
+              _mm256_srli_epi32 (c, 12));
+      c = _mm256_packus_epi16 (_mm256_packs_epi32 (c, zero), zero);
+      w [0] = _mm256_extract_epi32 (c, 0);
+      w [1] = _mm256_extract_epi32 (c, 4);
+      memcpy (code + (i >> 2), w, 8);
+     }
+
+   Encode_Scalar (s, i, n, code, bad, upper);
+
+   return;
+  }
+
+
+
+static void  Encode_SSE2
+    (const char * s, size_t n, unsigned char * code, uint64_t * bad,
+     char * upper)
+
+//  Convert  s  16 characters at a time with SSE2 instructions, which
+//  every x86-64 processor has.
+
+  {
+   const __m128i  before_a = _mm_set1_epi8 ('a' - 1);
+   const __m128i  after_z = _mm_set1_epi8 ('z' + 1);
+   const __m128i  case_bit = _mm_set1_epi8 ('a' - 'A');
+   const __m128i  ch_a = _mm_set1_epi8 ('A'), ch_c = _mm_set1_epi8 ('C');
+   const __m128i  ch_g = _mm_set1_epi8 ('G'), ch_t = _mm_set1_epi8 ('T');
+   const __m128i  three = _mm_set1_epi8 (3);
+   const __m128i  low_byte = _mm_set1_epi16 (0xff);
+   const __m128i  low_half = _mm_set1_epi32 (0xffff);
+   const __m128i  zero = _mm_setzero_si128 ();
+   size_t  i;
+
+   for  (i = 0;  i + 16 <= n;  i += 16)
+     {
+      __m128i  x, lower, good, c;
+      uint32_t  good_bits, w;
+
+      x = _mm_loadu_si128 ((const __m128i *) (s + i));
+      lower = _mm_and_si128 (_mm_cmpgt_epi8 (x, before_a),
+                  _mm_cmpgt_epi8 (after_z, x));
+      x = _mm_sub_epi8 (x, _mm_and_si128 (lower, case_bit));
+      if  (upper != NULL)
+          _mm_storeu_si128 ((__m128i *) (upper + i), x);
+      if  (code == NULL)
+          continue;
+
+      good = _mm_or_si128
+                 (_mm_or_si128 (_mm_cmpeq_epi8 (x, ch_a),
+                      _mm_cmpeq_epi8 (x, ch_c)),
+                  _mm_or_si128 (_mm_cmpeq_epi8 (x, ch_g),
+                      _mm_cmpeq_epi8 (x, ch_t)));
+      good_bits = _mm_movemask_epi8 (good);
+      bad [i >> 6] |= uint64_t (0xffff & ~ good_bits) << (i & 63);
+
+      c = _mm_xor_si128 (_mm_srli_epi16 (x, 1), _mm_srli_epi16 (x, 2));
+      c = _mm_and_si128 (_mm_and_si128 (c, three), good);
+      c = _mm_or_si128 (_mm_and_si128 (c, low_byte), _mm_srli_epi16 (c, 6));
+      c = _mm_or_si128 (_mm_and_si128 (c, low_half), _mm_srli_epi32 (c, 12));
+      c = _mm_packus_epi16 (_mm_packs_epi32 (c, zero), zero);
+      w = _mm_cvtsi128_si32 (c);
+      memcpy (code + (i >> 2), & w, 4);
+     }
+
+   Encode_Scalar (s, i, n, code, bad, upper);
+
+   return;
+  }
+
+#endif
+
+
+
+static Encode_Kernel_t  Choose_Kernel
+    (void)
+
+//  Return the fastest conversion kernel this processor can run.
+
+  {
+   Encode_Kernel_t  k = {Encode_Scalar, "scalar"};
+
+#if  defined (__x86_64__)
+   k . fn = Encode_SSE2;
+   k . name = "sse2";
+   if  (__builtin_cpu_supports ("avx2"))
+       {
+        k . fn = Encode_AVX2;
+        k . name = "avx2";
+       }
+#endif
+
+   return  k;
+  }
+
+
+
+static const Encode_Kernel_t &  Kernel
+    (void)
+
+//  Return the kernel to use, which is chosen the first time this
+//  is called.
+
+  {
+   static const Encode_Kernel_t  kernel = Choose_Kernel ();
+
+   return  kernel;
+  }
+
+
+
+void  Encode_Seq
+    (const char * s, size_t n, Packed_Seq_t & p, char * upper)
+
+//  Set  p  to the 2-bit codes of the  n  bases in  s , and if  upper
+//  isn't  NULL  store  s  converted to upper case there, which may
+//  be  s  itself.  Done in one pass over  s .
+
+  {
+   p . len = n;
+   p . code . assign ((n + 3) / 4, 0);
+   p . bad . assign ((n + 63) / 64, 0);
+
+   Kernel () . fn (s, n, p . code . data (), p . bad . data (), upper);
+
+   return;
+  }
+
+
+
+const char *  Encode_Seq_Kernel
+    (void)
+
+//  Return the name of the instruction set  Encode_Seq  uses.
+
+  {
+   return  Kernel () . name;
+  }
+
+
+
+bool  Packed_Seq_t :: Has_Bad
+    (size_t lo, size_t hi)  const
+
+//  Return  true  iff any of bases  lo .. (hi - 1)  isn't ACGT.
+//  Checks 64 bases at a time.
+
+  {
+   uint64_t  m;
+   size_t  w;
+
+   if  (hi <= lo)
+       return  false;
+
+   for  (w = lo >> 6;  w <= (hi - 1) >> 6;  w ++)
+     {
+      m = bad [w];
+      if  (w == (lo >> 6))
+          m &= ~ uint64_t (0) << (lo & 63);
+      if  (w == ((hi - 1) >> 6) && (hi & 63) != 0)
+          m &= ~ (~ uint64_t (0) << (hi & 63));
+      if  (m != 0)
+          return  true;
+     }
+
+   return  false;
+  }
+
+
+
+void  Upper_Case_Seq
+    (char * s, size_t n)
+
+//  Convert the  n  characters of  s  to upper case in place.
+
+  {
+   Kernel () . fn (s, n, NULL, NULL, s);
+
+   return;
+  }
@@ -0,0 +1,48 @@
+//  A. L. Delcher
+//
+//  File:  seq-encode.hh
+//
+//  Last Modified:  19 Oct 2026
+//
+//  Declarations for converting DNA sequences to upper case and
+//  2-bit codes using vector instructions where the processor has them
+
+
+#ifndef  __SEQ_ENCODE_HH_INCLUDED
+#define  __SEQ_ENCODE_HH_INCLUDED
+
+
+#include  "delcher.hh"
+#include  <stdint.h>
+
+
+struct  Packed_Seq_t
+  {
+   // A DNA sequence with 2 bits per base, A = 0, C = 1, G = 2, T = 3
+   // as in  Char_To_Bits , 4 bases to a byte with the first in the low
+   // bits.  Bases that aren't A, C, G or T (in either case) are coded
+   // as A, as  Char_To_Bits  does, and have their bit set in  bad .
+   vector <unsigned char>  code;
+   vector <uint64_t>  bad;
+     // bit  (i % 64)  of  bad [i / 64]  is set iff base  i  isn't ACGT
+   size_t  len;
+
+   unsigned  Base
+       (size_t i)  const
+     { return  (code [i >> 2] >> (2 * (i & 3))) & 3; }
+   bool  Is_Bad
+       (size_t i)  const
+     { return  (bad [i >> 6] >> (i & 63)) & 1; }
+   bool  Has_Bad
+       (size_t lo, size_t hi)  const;
+  };
+
+
+void  Encode_Seq
+    (const char * s, size_t n, Packed_Seq_t & p, char * upper = NULL);
+const char *  Encode_Seq_Kernel
+    (void);
+void  Upper_Case_Seq
+    (char * s, size_t n);
+
+#endif
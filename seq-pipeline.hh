@@ -0,0 +1,242 @@
+//  A. L. Delcher
+//
+//  File:  seq-pipeline.hh
+//
+//  Last Modified:  19 Oct 2026
+//
+//  A reader -> worker pool -> ordered writer pipeline for processing
+//  the records of a sequence file in parallel
+
+
+#ifndef  __SEQ_PIPELINE_HH_INCLUDED
+#define  __SEQ_PIPELINE_HH_INCLUDED
+
+#include  "delcher.hh"
+#include  "fasta.hh"
+
+#include  <condition_variable>
+#include  <functional>
+#include  <mutex>
+#include  <thread>
+
+
+const int  PIPELINE_SLOTS_PER_THREAD = 16;
+  // Default number of records in progress for each worker thread
+
+
+struct Seq_Record_t
+{
+  // A fasta or fastq record with nothing added for the processing
+  string  hdr, seq, qual;
+};
+
+template <class RT> class Seq_Pipeline_t
+{
+  // Reads records of type RT, which must have string members hdr, seq
+  // and qual, from a Seq_Reader_t in one thread, runs the process
+  // function on each of them in a pool of worker threads, and writes
+  // the output of each record in input order.  process writes its
+  // output to a buffer of its own for each record, and the finish
+  // function, if any, is run on each record in input order by the
+  // writer after its output is written, so it can print to other
+  // files or add up totals without locking.  At most max_pending
+  // records are in progress at once; the reader waits when they're
+  // all used, so memory stays bounded however far ahead of the workers
+  // or the writer it gets.  Records and their string buffers are reused.
+private:
+  struct Slot_t
+  {
+    RT  rec;
+    char  * buff;
+    size_t  len;
+      // output of process for this record
+    bool  done;
+      // true when process is finished with it
+  };
+
+  vector <Slot_t>  slot;
+    // circular queue of records in progress; record i is in
+    // slot [i % slot . size ()]
+  long int  num_read, num_started, num_written;
+    // records read, handed to workers and written, respectively
+  bool  at_end;
+    // true when the reader has reached the end of the file
+  std :: mutex  lock;
+  std :: condition_variable  changed;
+
+  void  Read_All
+    (Seq_Reader_t * reader);
+  void  Work
+    (void);
+
+public:
+  std :: function <void (RT &, FILE *)>  process;
+    // processes a record and writes its output to the FILE *
+  std :: function <void (RT &)>  finish;
+    // run on each record in input order after its output is written
+
+  long int  Run
+    (Seq_Reader_t & reader, FILE * out, int num_threads,
+     int max_pending = 0);
+};
+
+
+template <class RT> void  Seq_Pipeline_t <RT> :: Read_All
+  (Seq_Reader_t * reader)
+
+// Read records from reader into free slots until the end of the
+// file, waiting whenever all slots are in use.
+
+{
+  long int  n = slot . size ();
+  bool  ok;
+
+  while (true)
+    {
+      {
+        std :: unique_lock <std :: mutex>  guard (lock);
+
+        while (num_read - num_written == n)
+          changed . wait (guard);
+      }
+
+      // the slot isn't visible to the workers until num_read is advanced
+      RT  & r = slot [num_read % n] . rec;
+
+      ok = reader -> Next (r . seq, r . qual, r . hdr);
+
+      std :: unique_lock <std :: mutex>  guard (lock);
+
+      if (ok)
+        num_read ++;
+      else
+        at_end = true;
+      changed . notify_all ();
+      if (! ok)
+        break;
+    }
+
+  return;
+}
+
+
+template <class RT> long int  Seq_Pipeline_t <RT> :: Run
+  (Seq_Reader_t & reader, FILE * out, int num_threads, int max_pending)
+
+// Process every record from reader with num_threads worker threads,
+// writing their output to out in input order.  Keep at most max_pending
+// records in progress, or PIPELINE_SLOTS_PER_THREAD per thread if it's
+// zero.  Return the number of records processed.  With one thread, just
+// process and finish each record in turn as it's read, with process
+// writing directly to out.
+
+{
+  vector <std :: thread>  worker;
+  std :: thread  reader_thread;
+  long int  n;
+  int  i;
+
+  if (num_threads <= 1)
+    {
+      RT  r;
+
+      for (n = 0; reader . Next (r . seq, r . qual, r . hdr); n ++)
+        {
+          process (r, out);
+          if (finish)
+            finish (r);
+        }
+      return  n;
+    }
+
+  if (max_pending <= 0)
+    max_pending = PIPELINE_SLOTS_PER_THREAD * num_threads;
+  slot . resize (max_pending);
+  for (i = 0; i < max_pending; i ++)
+    slot [i] . done = false;
+  n = max_pending;
+  num_read = num_started = num_written = 0;
+  at_end = false;
+
+  reader_thread = std :: thread (& Seq_Pipeline_t :: Read_All, this, & reader);
+  for (i = 0; i < num_threads; i ++)
+    worker . push_back (std :: thread (& Seq_Pipeline_t :: Work, this));
+
+  // Write the records' output in order as it becomes available
+  while (true)
+    {
+      Slot_t  * s;
+
+      {
+        std :: unique_lock <std :: mutex>  guard (lock);
+
+        while (! (num_written < num_read && slot [num_written % n] . done)
+               && ! (at_end && num_written == num_read))
+          changed . wait (guard);
+        if (num_written == num_read)
+          break;
+        s = & slot [num_written % n];
+      }
+
+      fwrite (s -> buff, 1, s -> len, out);
+      free (s -> buff);
+      if (finish)
+        finish (s -> rec);
+
+      std :: unique_lock <std :: mutex>  guard (lock);
+
+      s -> done = false;
+      num_written ++;
+      changed . notify_all ();
+    }
+
+  reader_thread . join ();
+  for (i = 0; i < num_threads; i ++)
+    worker [i] . join ();
+
+  return  num_written;
+}
+
+
+template <class RT> void  Seq_Pipeline_t <RT> :: Work
+  (void)
+
+// Run by each worker thread.  Take the next record that's been read
+// and not started, run process on it with its output going to the
+// slot's buffer, and mark it done.  Stop when all records are started
+// and the reader is at the end of the file.
+
+{
+  long int  n = slot . size ();
+
+  while (true)
+    {
+      Slot_t  * s;
+      FILE  * fp;
+
+      {
+        std :: unique_lock <std :: mutex>  guard (lock);
+
+        while (num_started == num_read && ! at_end)
+          changed . wait (guard);
+        if (num_started == num_read)
+          break;
+        s = & slot [num_started % n];
+        num_started ++;
+      }
+
+      fp = open_memstream (& s -> buff, & s -> len);
+      process (s -> rec, fp);
+      fclose (fp);
+
+      std :: unique_lock <std :: mutex>  guard (lock);
+
+      s -> done = true;
+      changed . notify_all ();
+    }
+
+  return;
+}
+
+
+#endif
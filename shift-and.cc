@@ -0,0 +1,145 @@
+//  A. L. Delcher
+//
+//  File:  shift-and.cc
+//
+//  Last Modified:  19 Oct 2026
+//
+//  A bit-parallel Shift-And matcher to find all occurrences of a set
+//  of short patterns with up to k mismatches in one pass
+
+
+#include  "shift-and.hh"
+
+
+
+Shift_And_t :: Shift_And_t
+    ()
+
+  {
+   max_mismatches = 0;
+  }
+
+
+
+void  Shift_And_t :: Add
+    (const char * p)
+
+//  Add  p  to the patterns to search for.  Its subscript in matches
+//  is the number of patterns added before it.  An empty pattern never
+//  matches.
+
+  {
+   pattern . push_back (p);
+
+   return;
+  }
+
+
+
+void  Shift_And_t :: Build
+    (int k)
+
+//  Pack the patterns into as few state words as possible, taking them
+//  in the order added, and set the matcher to allow  k  mismatches.
+//  Exit with a message if a pattern is longer than a word.
+
+  {
+   Shift_And_Group_t  * g = NULL;
+   int  i, j, n, used = SHIFT_AND_WORD_BITS;
+
+   max_mismatches = k;
+   group . clear ();
+
+   for  (i = 0;  i < Num_Patterns ();  i ++)
+     {
+      n = pattern [i] . length ();
+      if  (n == 0)
+          continue;
+      if  (SHIFT_AND_WORD_BITS < n)
+          {
+           sprintf (Clean_Exit_Msg_Line,
+                "ERROR:  Pattern %s is longer than %d characters",
+                pattern [i] . c_str (), SHIFT_AND_WORD_BITS);
+           Clean_Exit (Clean_Exit_Msg_Line, __FILE__, __LINE__);
+          }
+
+      if  (SHIFT_AND_WORD_BITS < used + n)
+          {
+           group . resize (group . size () + 1);
+           g = & group . back ();
+           memset (g, 0, sizeof (Shift_And_Group_t));
+           used = 0;
+          }
+
+      for  (j = 0;  j < n;  j ++)
+        g -> mask [(unsigned char) pattern [i] [j]] |= uint64_t (1) << (used + j);
+      g -> first |= uint64_t (1) << used;
+      g -> last |= uint64_t (1) << (used + n - 1);
+      g -> pattern [used + n - 1] = i;
+      used += n;
+     }
+
+   return;
+  }
+
+
+
+void  Shift_And_t :: Scan
+    (const char * s, size_t n, vector <Pattern_Match_t> & match)  const
+
+//  Set  match  to all occurrences in the  n  characters of  s  of the
+//  patterns with at most  max_mismatches  mismatches, in order of their
+//  end positions, each with its least number of mismatches.  Patterns
+//  that end at the same position are in no particular order.
+//  Shifting carries the last bit of each pattern into the first bit
+//  of the next one, but that's harmless since first bits are always
+//  set before masking.
+
+  {
+   Pattern_Match_t  m;
+   vector <uint64_t>  state;
+   uint64_t  hits, prev, curr, * r;
+   int  num_groups, k;
+   int  b, d, g;
+   size_t  i;
+
+   match . clear ();
+
+   k = max_mismatches;
+   num_groups = group . size ();
+   state . assign (num_groups * (k + 1), 0);
+
+   for  (i = 0;  i < n;  i ++)
+     {
+      unsigned char  ch = s [i];
+
+      for  (g = 0;  g < num_groups;  g ++)
+        {
+         const Shift_And_Group_t  & G = group [g];
+
+         r = & state [g * (k + 1)];
+         prev = r [0];
+         r [0] = ((r [0] << 1) | G . first) & G . mask [ch];
+         for  (d = 1;  d <= k;  d ++)
+           {
+            curr = r [d];
+            r [d] = (((curr << 1) | G . first) & G . mask [ch])
+                      | (prev << 1) | G . first;
+            prev = curr;
+           }
+
+         for  (hits = r [k] & G . last;  hits != 0;  hits &= hits - 1)
+           {
+            b = __builtin_ctzll (hits);
+            for  (d = 0;  ((r [d] >> b) & 1) == 0;  d ++)
+              ;
+            m . end = i;
+            m . pattern = G . pattern [b];
+            m . mismatches = d;
+            match . push_back (m);
+           }
+        }
+     }
+
+   return;
+  }
@@ -0,0 +1,71 @@
+//  A. L. Delcher
+//
+//  File:  shift-and.hh
+//
+//  Last Modified:  19 Oct 2026
+//
+//  A bit-parallel Shift-And matcher to find all occurrences of a set
+//  of short patterns with up to k mismatches in one pass
+
+
+#ifndef  __SHIFT_AND_H_INCLUDED
+#define  __SHIFT_AND_H_INCLUDED
+
+
+#include  "delcher.hh"
+#include  "aho-corasick.hh"
+#include  <stdint.h>
+
+
+const int  SHIFT_AND_WORD_BITS = 64;
+  // Bits in the state words, which is the longest pattern allowed
+
+
+struct  Shift_And_Group_t
+  {
+   // Patterns packed side by side in one state word, each taking as
+   // many bits as it has characters, with its first character in the
+   // lowest of them
+   uint64_t  mask [256];
+     // bit  j  of  mask [c]  is set iff the pattern character at bit  j
+     // is  c
+   uint64_t  first, last;
+     // bits of the first and last characters of the patterns
+   int  pattern [SHIFT_AND_WORD_BITS];
+     // subscript of the pattern whose last character is at each bit
+     // of  last
+  };
+
+
+class  Shift_And_t
+  {
+   // The Shift-And algorithm extended to mismatches:  after each
+   // character of the string, bit  j  of state word  d  is set iff the
+   // pattern characters up to bit  j  match the string ending there
+   // with at most  d  mismatches.  Word  d  is shifted in from word  d
+   // on a match and from word  d - 1  on a mismatch, so each character
+   // takes  k + 1  word operations for every word of patterns, however
+   // many patterns are packed in it.  Matching is case-sensitive and
+   // mismatches are substitutions only, so a match is the same length
+   // as its pattern.
+   private:
+     vector <string>  pattern;
+     vector <Shift_And_Group_t>  group;
+     int  max_mismatches;
+
+   public:
+     Shift_And_t
+         ();
+     void  Add
+         (const char * p);
+     void  Build
+         (int k);
+     int  Num_Patterns
+         (void)  const
+       { return  int (pattern . size ()); }
+     void  Scan
+         (const char * s, size_t n, vector <Pattern_Match_t> & match)  const;
+  };
+
+
+#endif